@@ -0,0 +1,172 @@
+#include <array>
+#include <cstring>
+#include <QIODevice>
+#include <QVector>
+#include <QtEndian>
+#include "apngwriter.h"
+
+namespace {
+    const char Signature[8] = {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n'};
+
+    struct Chunk
+    {
+        QByteArray type;
+        // Points into the PNG file it was parsed from.
+        QByteArray data;
+    };
+
+    quint32 crc32(const char *bytes, int size, quint32 crc)
+    {
+        static const auto table = [] {
+            std::array<quint32, 256> ret;
+            for (quint32 n = 0; n < 256; ++n) {
+                quint32 c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                ret[n] = c;
+            }
+            return ret;
+        }();
+
+        for (int i = 0; i < size; ++i)
+            crc = table[(crc ^ uchar(bytes[i])) & 0xff] ^ (crc >> 8);
+        return crc;
+    }
+
+    bool parseChunks(const QByteArray& png, QVector<Chunk>& chunks)
+    {
+        if (!png.startsWith(QByteArray::fromRawData(Signature, sizeof Signature)))
+            return false;
+
+        int pos = sizeof Signature;
+        while (pos + 12 <= png.size()) {
+            const quint32 size = qFromBigEndian<quint32>(png.constData() + pos);
+            if (size > quint32(png.size() - pos - 12))
+                return false;
+
+            chunks += Chunk{png.mid(pos + 4, 4),
+                            QByteArray::fromRawData(png.constData() + pos + 8, int(size))};
+            pos += 12 + int(size);
+            if (chunks.last().type == "IEND")
+                return true;
+        }
+        return false;
+    }
+}
+
+ApngWriter::ApngWriter(QIODevice *device, int delay)
+    : m_device(device),
+      m_delay(qBound(0, delay, 0xffff))
+{ }
+
+bool ApngWriter::fail(const QString& message)
+{
+    m_error = message;
+    return false;
+}
+
+bool ApngWriter::writeChunk(const char *type, const QByteArray& data)
+{
+    QByteArray chunk(12 + data.size(), Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar*>(chunk.data());
+    qToBigEndian(quint32(data.size()), out);
+    std::memcpy(out + 4, type, 4);
+    std::memcpy(out + 8, data.constData(), size_t(data.size()));
+
+    const quint32 crc = ~crc32(chunk.constData() + 4, 4 + data.size(), 0xffffffffu);
+    qToBigEndian(crc, out + 8 + data.size());
+
+    if (m_device->write(chunk) != chunk.size())
+        return fail(m_device->errorString());
+    return true;
+}
+
+QByteArray ApngWriter::animationControl() const
+{
+    // Frame count, then the number of loops, zero for endless.
+    QByteArray ret(8, Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar*>(ret.data());
+    qToBigEndian(quint32(m_frames), out);
+    qToBigEndian(quint32(0), out + 4);
+    return ret;
+}
+
+// Each frame covers the whole image, shown for m_delay milliseconds, and
+// replaces the previous one.
+bool ApngWriter::writeFrameControl(const QByteArray& header)
+{
+    QByteArray control(26, '\0');
+    uchar *out = reinterpret_cast<uchar*>(control.data());
+    qToBigEndian(m_sequence++, out);
+    std::memcpy(out + 4, header.constData(), 8);
+    qToBigEndian(quint16(m_delay), out + 20);
+    qToBigEndian(quint16(1000), out + 22);
+    return writeChunk("fcTL", control);
+}
+
+bool ApngWriter::addFrame(const QByteArray& png)
+{
+    QVector<Chunk> chunks;
+    if (!parseChunks(png, chunks) || chunks.first().type != "IHDR"
+        || chunks.first().data.size() != 13)
+        return fail("not a PNG image");
+
+    const QByteArray& header = chunks.first().data;
+    if (m_frames == 0) {
+        m_header = QByteArray(header.constData(), header.size());
+        if (m_device->write(Signature, sizeof Signature) != sizeof Signature)
+            return fail(m_device->errorString());
+        if (!writeChunk("IHDR", m_header))
+            return false;
+        m_animationControlPos = m_device->pos();
+        if (!writeChunk("acTL", animationControl()))
+            return false;
+    } else if (header != m_header) {
+        return fail("frame differs in size or type from the first one");
+    }
+
+    bool started = false;
+    for (const Chunk& chunk : chunks) {
+        if (chunk.type == "IDAT") {
+            if (!started && !writeFrameControl(m_header))
+                return false;
+            started = true;
+
+            if (m_frames == 0) {
+                if (!writeChunk("IDAT", chunk.data))
+                    return false;
+                continue;
+            }
+
+            QByteArray data(4 + chunk.data.size(), Qt::Uninitialized);
+            qToBigEndian(m_sequence++, reinterpret_cast<uchar*>(data.data()));
+            std::memcpy(data.data() + 4, chunk.data.constData(), size_t(chunk.data.size()));
+            if (!writeChunk("fdAT", data))
+                return false;
+        } else if (m_frames == 0 && !started && chunk.type != "IHDR" && chunk.type != "IEND") {
+            // Chunks such as the palette, which have to precede the image
+            // data, are taken from the first frame.
+            if (!writeChunk(chunk.type.constData(), chunk.data))
+                return false;
+        }
+    }
+
+    if (!started)
+        return fail("PNG image has no image data");
+    ++m_frames;
+    return true;
+}
+
+bool ApngWriter::finish()
+{
+    if (m_frames == 0)
+        return fail("no frames");
+    if (!writeChunk("IEND", QByteArray()))
+        return false;
+
+    const qint64 end = m_device->pos();
+    if (!m_device->seek(m_animationControlPos) || !writeChunk("acTL", animationControl())
+        || !m_device->seek(end))
+        return fail(m_device->errorString());
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef APNGWRITER_H_INCLUDED
+#define APNGWRITER_H_INCLUDED
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+class QIODevice;
+
+// Assembles an animated PNG from frames already encoded as PNG files, all of
+// the same size and type, such as QImageWriter writes them.  Each frame is
+// written to the device as soon as it is added: the image data of the first
+// one is the default image, the others go into fdAT chunks.  The device must
+// be seekable, as finish() patches the frame count into the header.
+class ApngWriter
+{
+public:
+    // `delay' is how long each frame is shown, in milliseconds.
+    explicit ApngWriter(QIODevice *device, int delay = 100);
+
+    bool addFrame(const QByteArray& png);
+    // Ends the file; no frames may be added afterwards.
+    bool finish();
+
+    int frameCount() const { return m_frames; }
+    QString errorString() const { return m_error; }
+
+private:
+    bool fail(const QString& message);
+    bool writeChunk(const char *type, const QByteArray& data);
+    bool writeFrameControl(const QByteArray& header);
+    QByteArray animationControl() const;
+
+    QIODevice *m_device;
+    int m_delay;
+    int m_frames = 0;
+    quint32 m_sequence = 0;
+    // Header of the first frame, which all others must match.
+    QByteArray m_header;
+    qint64 m_animationControlPos = -1;
+    QString m_error;
+};
+
+#endif /* APNGWRITER_H_INCLUDED */
@@ -0,0 +1,192 @@
+#include <random>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QPair>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QTextStream>
+#include "benchmark.h"
+#include "grid.h"
+#include "patternwriter.h"
+#include "planeengine.h"
+
+namespace {
+    // Whether `copy' holds the same pattern as `cells', wherever each of
+    // them has it; text formats only keep the bounding box.
+    bool samePattern(const CellBitSet& cells, const CellBitSet& copy)
+    {
+        QRect bounds = PatternWriter::boundingRect(cells);
+        QRect copyBounds = PatternWriter::boundingRect(copy);
+        if (bounds.size() != copyBounds.size() || cells.count() != copy.count())
+            return false;
+
+        QPoint offset = bounds.topLeft() - copyBounds.topLeft();
+        for (const QPoint& cell : copy)
+            if (!cells.test(cell + offset))
+                return false;
+        return true;
+    }
+}
+
+void Benchmark::fillSoup(Grid *grid) const
+{
+    std::mt19937 random(seed);
+    std::bernoulli_distribution alive(density);
+
+    for (int y = 0; y < grid->rows(); ++y)
+        for (int x = 0; x < grid->cols(); ++x)
+            if (alive(random))
+                grid->setCellStateAt({x, y}, true);
+}
+
+int Benchmark::run() const
+{
+    if (compareEngines)
+        return runEngineComparison();
+
+    QTextStream out(stdout);
+    Grid grid(size);
+    fillSoup(&grid);
+
+    const CellBitSet initial = grid.cells();
+    QScopedPointer<Engine> engine(Engine::create(engineType, engineOptions));
+    out << "engine: " << engine->name() << "\n"
+        << "size: " << size.width() << "x" << size.height() << "\n"
+        << "initial population: " << grid.population() << "\n";
+    out.flush();
+
+    QElapsedTimer timer;
+    int generation = 0;
+
+    timer.start();
+    if (jump) {
+        engine->advance(grid, generations).apply(&grid);
+        generation = generations;
+    }
+
+    ChangeSet changes;
+    for (; generation < generations; ++generation) {
+        engine->nextGeneration(grid, changes);
+        if (changes.isEmpty() && !engine->changedOffGrid())
+            break;
+        changes.apply(&grid);
+    }
+
+    double seconds = timer.nsecsElapsed() / 1e9;
+    out << "generations: " << generation << "\n"
+        << "final population: " << grid.population() << "\n"
+        << "seconds: " << seconds << "\n"
+        << "generations/s: " << (seconds > 0 ? generation / seconds : 0) << "\n";
+
+    if (auto plane = dynamic_cast<const PlaneEngine*>(engine.data())) {
+        SparsePlane::Bounds bounds = plane->plane().boundingBox();
+        out << "plane population: " << plane->plane().population() << "\n"
+            << "plane bounding box: " << bounds.width() << "x" << bounds.height() << "\n";
+    }
+
+    int ret = 0;
+
+    // The soup fills the grid, so this also covers patterns running into the
+    // border.
+    if (check) {
+        Grid reference(size);
+        reference.setCells(initial);
+
+        QScopedPointer<Engine> packed(Engine::create(Engine::Type::Packed, engineOptions));
+        for (int i = 0; i < generation; ++i) {
+            packed->nextGeneration(reference, changes);
+            changes.apply(&reference);
+        }
+
+        bool same = ChangeSet::difference(reference.cells(), grid.cells()).isEmpty();
+        out << "check: " << (same ? "matches packed stepping" : "differs from packed stepping")
+            << "\n";
+        if (!same)
+            ret = 1;
+    }
+
+    if (io) {
+        const QVector<QPair<PatternFormat, QString>> formats = {
+            {PatternFormat::Native, "native"}, {PatternFormat::Rle, "rle"},
+            {PatternFormat::Life106, "life 1.06"}, {PatternFormat::Plaintext, "plaintext"},
+            {PatternFormat::Snapshot, "snapshot"}};
+
+        for (const auto& format : formats) {
+            QBuffer buffer;
+            buffer.open(QIODevice::WriteOnly);
+            timer.restart();
+            grid.save(&buffer, format.first);
+            double saveSeconds = timer.nsecsElapsed() / 1e9;
+            buffer.close();
+
+            Grid loaded({1, 1});
+            buffer.open(QIODevice::ReadOnly);
+            timer.restart();
+            bool ok = loaded.load(&buffer, format.first);
+            double loadSeconds = timer.nsecsElapsed() / 1e9;
+
+            bool same = ok && samePattern(grid.cells(), loaded.cells());
+            if (!same)
+                ret = 1;
+
+            double megabytes = buffer.size() / 1e6;
+            out << format.second << ": " << megabytes << " MB, save "
+                << megabytes / saveSeconds << " MB/s, load " << megabytes / loadSeconds << " MB/s"
+                << (!ok ? " (load failed)" : same ? "" : " (round trip differs)") << "\n";
+        }
+    }
+
+    return ret;
+}
+
+int Benchmark::runEngineComparison() const
+{
+    // The unbounded engine lets the soup past the border, so it is left out.
+    const QVector<Engine::Type> types = {Engine::Type::Packed, Engine::Type::Sparse,
+                                         Engine::Type::Hashlife, Engine::Type::Frontier};
+    QTextStream out(stdout);
+    Grid initial(size);
+    fillSoup(&initial);
+
+    out << "size: " << size.width() << "x" << size.height() << "\n"
+        << "initial population: " << initial.population() << "\n";
+    out.flush();
+
+    QVector<QSharedPointer<Engine>> engines;
+    QVector<QSharedPointer<Grid>> grids;
+    for (Engine::Type type : types) {
+        engines += QSharedPointer<Engine>(Engine::create(type, engineOptions));
+        grids += QSharedPointer<Grid>(initial.clone());
+    }
+
+    ChangeSet changes;
+    for (int generation = 1; generation <= generations; ++generation) {
+        for (int i = 0; i < engines.size(); ++i) {
+            engines[i]->nextGeneration(*grids[i], changes);
+            changes.apply(grids[i].data());
+        }
+
+        for (int i = 1; i < engines.size(); ++i) {
+            if (!ChangeSet::difference(grids[0]->cells(), grids[i]->cells()).isEmpty()) {
+                out << "generation " << generation << ": " << engines[i]->name()
+                    << " differs from " << engines[0]->name() << "\n";
+                return 1;
+            }
+        }
+    }
+
+    for (int i = 0; i < types.size(); ++i) {
+        QScopedPointer<Engine> engine(Engine::create(types[i], engineOptions));
+        QScopedPointer<Grid> grid(initial.clone());
+        engine->advance(*grid, generations).apply(grid.data());
+
+        if (!ChangeSet::difference(grids[0]->cells(), grid->cells()).isEmpty()) {
+            out << "jump: " << engine->name() << " differs from stepping\n";
+            return 1;
+        }
+    }
+
+    out << "engines agree over " << generations << " generations, final population "
+        << grids[0]->population() << "\n";
+    return 0;
+}
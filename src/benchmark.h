@@ -0,0 +1,41 @@
+#ifndef BENCHMARK_H_INCLUDED
+#define BENCHMARK_H_INCLUDED
+
+#include <QSize>
+#include "engine.h"
+
+class Grid;
+
+// Steps a random soup without a GUI and reports the stepping rate, and
+// optionally the pattern I/O throughput, on the standard output.  run()
+// returns non-zero if a check fails.
+class Benchmark
+{
+public:
+    Engine::Type engineType = Engine::Type::Packed;
+    EngineOptions engineOptions;
+    QSize size{2048, 2048};
+    int generations = 1000;
+    double density = 0.5;
+    quint32 seed = 1;
+    // Advance over all generations at once rather than one by one.
+    bool jump = false;
+    // Also time saving and loading the final grid in every pattern format,
+    // checking that each gives back the same pattern.
+    bool io = false;
+    // Also check that the final grid matches stepping the packed engine one
+    // generation at a time.
+    bool check = false;
+    // Instead of timing, step the soup with every bounded engine side by
+    // side, and jump over the generations with each, checking that they all
+    // agree.
+    bool compareEngines = false;
+
+    int run() const;
+
+private:
+    void fillSoup(Grid *grid) const;
+    int runEngineComparison() const;
+};
+
+#endif /* BENCHMARK_H_INCLUDED */
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <QtAlgorithms>
+#include "cellbitset.h"
+
+CellBitSet::const_iterator::const_iterator(const CellBitSet *set, int band)
+    : m_set(set),
+      m_band(band),
+      m_word(-1)
+{
+    if (m_band < m_set->bands())
+        advance();
+    else
+        m_word = 0;
+}
+
+CellBitSet::const_iterator CellBitSet::const_iterator::operator++(int)
+{
+    auto ret = *this;
+    advance();
+    return ret;
+}
+
+void CellBitSet::const_iterator::advance()
+{
+    while (m_bits == 0) {
+        if (++m_word >= m_set->bandWords(m_band)) {
+            m_word = -1;
+            if (++m_band >= m_set->bands()) {
+                m_word = 0;
+                return;
+            }
+            continue;
+        }
+        m_bits = m_set->m_bandData.at(m_band)[m_word];
+        if ((m_word + 1) % m_set->m_wordsPerRow == 0)
+            m_bits &= m_set->lastWordMask();
+    }
+
+    int bit = qCountTrailingZeroBits(m_bits);
+    m_bits &= m_bits - 1;
+
+    int wordsPerRow = m_set->m_wordsPerRow;
+    m_cell = {m_word % wordsPerRow * WordBits + bit,
+              m_band * BandRows + m_word / wordsPerRow};
+}
+
+CellBitSet CellBitSet::fromRawBands(const QSize& size, const QVector<const Word*>& bands,
+                                    std::shared_ptr<const void> owner)
+{
+    CellBitSet ret;
+    ret.m_size = size;
+    ret.m_wordsPerRow = wordsForColumns(size.width());
+    ret.m_owner = std::move(owner);
+
+    ret.m_bands.resize(bands.size());
+    ret.m_bandData = bands;
+
+    // Empty bands all share one zeroed vector until written to.
+    QVector<Word> empty;
+    for (int band = 0; band < bands.size(); ++band) {
+        if (bands.at(band))
+            continue;
+        if (empty.size() != ret.bandWords(band))
+            empty = QVector<Word>(ret.bandWords(band), 0);
+        ret.setBand(band, empty);
+    }
+
+    Q_ASSERT(ret.m_bands.size() == (size.height() + BandRows - 1) / BandRows);
+    return ret;
+}
+
+void CellBitSet::adoptBand(int band)
+{
+    QVector<Word> words(bandWords(band));
+    std::copy_n(m_bandData.at(band), words.size(), words.data());
+    const Word mask = lastWordMask();
+    if (mask != ~Word(0))
+        for (int i = m_wordsPerRow - 1; i < words.size(); i += m_wordsPerRow)
+            words[i] &= mask;
+    setBand(band, words);
+}
+
+void CellBitSet::setBand(int band, const QVector<Word>& words)
+{
+    m_bands[band] = words;
+    m_bandData[band] = m_bands.at(band).constData();
+}
+
+CellBitSet::Word CellBitSet::lastWordMask() const
+{
+    int used = cols() % WordBits;
+    return used == 0 ? ~Word(0) : (Word(1) << used) - 1;
+}
+
+void CellBitSet::set(const QPoint& cell, bool state)
+{
+    Q_ASSERT(contains(cell));
+
+    Word bit = Word(1) << (cell.x() % WordBits);
+    Word& word = row(cell.y())[cell.x() / WordBits];
+
+    if (state)
+        word |= bit;
+    else
+        word &= ~bit;
+}
+
+void CellBitSet::resize(const QSize& size)
+{
+    Q_ASSERT(size.width() >= 0 && size.height() >= 0);
+    if (size == m_size)
+        return;
+
+    const CellBitSet& old = *this;
+    CellBitSet ret;
+    ret.m_size = size;
+    ret.m_wordsPerRow = wordsForColumns(size.width());
+
+    const int bands = (size.height() + BandRows - 1) / BandRows;
+    ret.m_bands.resize(bands);
+    ret.m_bandData.resize(bands);
+    for (int band = 0; band < bands; ++band)
+        ret.setBand(band, QVector<Word>(ret.bandWords(band), 0));
+
+    int rows = std::min(this->rows(), ret.rows());
+    int words = std::min(m_wordsPerRow, ret.m_wordsPerRow);
+    // The last word copied is cut at whichever row ends first.
+    Word mask = ~Word(0);
+    if (words == m_wordsPerRow)
+        mask &= lastWordMask();
+    if (words == ret.m_wordsPerRow)
+        mask &= ret.lastWordMask();
+
+    if (words > 0) {
+        for (int y = 0; y < rows; ++y) {
+            std::copy_n(old.row(y), words, ret.row(y));
+            ret.row(y)[words - 1] &= mask;
+        }
+    }
+
+    *this = std::move(ret);
+}
+
+// Bands that are already empty are left alone, so clearing a copy does not
+// duplicate the bands it shares.
+void CellBitSet::clear()
+{
+    for (int band = 0; band < bands(); ++band)
+        if (!bandIsEmpty(band))
+            setBand(band, QVector<Word>(bandWords(band), 0));
+}
+
+int CellBitSet::count() const
+{
+    const Word padding = ~lastWordMask();
+    int ret = 0;
+    for (int band = 0; band < bands(); ++band) {
+        const Word *words = m_bandData.at(band);
+        for (int i = 0; i < bandWords(band); ++i)
+            ret += qPopulationCount(words[i]);
+        if (padding)
+            for (int i = m_wordsPerRow - 1; i < bandWords(band); i += m_wordsPerRow)
+                ret -= qPopulationCount(words[i] & padding);
+    }
+    return ret;
+}
+
+bool CellBitSet::isEmpty() const
+{
+    for (int band = 0; band < bands(); ++band)
+        if (!bandIsEmpty(band))
+            return false;
+    return true;
+}
+
+bool CellBitSet::bandIsEmpty(int band) const
+{
+    const Word *words = m_bandData.at(band);
+    const Word mask = lastWordMask();
+    for (int i = 0; i < bandWords(band); i += m_wordsPerRow) {
+        const Word *row = words + i;
+        if (std::any_of(row, row + m_wordsPerRow - 1, [] (Word word) { return word != 0; })
+            || row[m_wordsPerRow - 1] & mask)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,142 @@
+#ifndef CELLBITSET_H_INCLUDED
+#define CELLBITSET_H_INCLUDED
+
+#include <iterator>
+#include <memory>
+#include <QPoint>
+#include <QSize>
+#include <QVector>
+#include <QtGlobal>
+
+// Dense storage of cell states, one bit per cell.  Every row starts on a word
+// boundary; bit i of word w in a row is the cell in column w * WordBits + i.
+// Bits past the last column are kept zero, except in bands borrowed through
+// fromRawBands(): cleaning those up front would touch every row.  Whoever
+// reads row() masks the last word with lastWordMask().
+//
+// Rows are stored in bands of BandRows rows, each an implicitly shared
+// vector.  Copying a bit set is O(1) and writing to the copy only duplicates
+// the bands actually written to.  Bands may also live in memory owned
+// elsewhere, such as a mapped file, and are copied on their first write.
+class CellBitSet
+{
+public:
+    using Word = quint64;
+    static constexpr int WordBits = 64;
+    static constexpr int BandRows = 64;
+
+    // Walks the live cells in row-major order.
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = QPoint;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const QPoint*;
+        using reference = const QPoint&;
+
+        const_iterator() = default;
+
+        const QPoint& operator*() const { return m_cell; }
+        const QPoint* operator->() const { return &m_cell; }
+
+        const_iterator& operator++() { advance(); return *this; }
+        const_iterator operator++(int);
+
+        bool operator==(const const_iterator& rhs) const
+        {
+            return m_band == rhs.m_band && m_word == rhs.m_word && m_bits == rhs.m_bits;
+        }
+        bool operator!=(const const_iterator& rhs) const { return !(*this == rhs); }
+
+    private:
+        friend class CellBitSet;
+        const_iterator(const CellBitSet *set, int band);
+        void advance();
+
+        const CellBitSet *m_set = nullptr;
+        // Band and word within it of the bits being walked.
+        int m_band = 0;
+        int m_word = 0;
+        Word m_bits = 0;
+        QPoint m_cell;
+    };
+
+    CellBitSet() = default;
+    explicit CellBitSet(const QSize& size) { resize(size); }
+
+    // Wraps bands of bit-packed rows owned by something else, which `owner'
+    // keeps alive.  Each band holds its rows laid out as row() returns them;
+    // null bands are empty.  Bits past the last column are ignored, and
+    // dropped when a band is copied on its first write.
+    static CellBitSet fromRawBands(const QSize& size, const QVector<const Word*>& bands,
+                                   std::shared_ptr<const void> owner);
+
+    static int wordsForColumns(int cols) { return (cols + WordBits - 1) / WordBits; }
+
+    QSize size() const { return m_size; }
+    int cols() const { return m_size.width(); }
+    int rows() const { return m_size.height(); }
+    int wordsPerRow() const { return m_wordsPerRow; }
+    Word lastWordMask() const;
+
+    bool contains(const QPoint& cell) const
+    {
+        return cell.x() >= 0 && cell.y() >= 0 && cell.x() < cols() && cell.y() < rows();
+    }
+    bool test(const QPoint& cell) const
+    {
+        return contains(cell)
+            && (row(cell.y())[cell.x() / WordBits] >> (cell.x() % WordBits)) & 1;
+    }
+    void set(const QPoint& cell, bool state);
+
+    void resize(const QSize& size);
+    void clear();
+    int count() const;
+    bool isEmpty() const;
+
+    const Word *row(int y) const
+    {
+        return m_bandData.at(y / BandRows) + y % BandRows * m_wordsPerRow;
+    }
+    Word *row(int y) { return writableBand(y / BandRows) + y % BandRows * m_wordsPerRow; }
+
+    // Whether a band of rows is shared with another bit set of the same size,
+    // in which case its contents are equal.
+    int bands() const { return m_bands.size(); }
+    bool bandShared(const CellBitSet& other, int band) const
+    {
+        return m_bandData.at(band) == other.m_bandData.at(band);
+    }
+    int bandWords(int band) const
+    {
+        return qMin(int(BandRows), rows() - band * BandRows) * m_wordsPerRow;
+    }
+
+    const_iterator begin() const { return { this, 0 }; }
+    const_iterator end() const { return { this, m_bands.size() }; }
+
+private:
+    Word *writableBand(int band)
+    {
+        QVector<Word>& words = m_bands[band];
+        if (Q_UNLIKELY(words.constData() != m_bandData.at(band)))
+            adoptBand(band);
+        Word *ret = words.data();
+        m_bandData[band] = ret;
+        return ret;
+    }
+    void adoptBand(int band);
+    void setBand(int band, const QVector<Word>& words);
+    bool bandIsEmpty(int band) const;
+
+    QSize m_size{0, 0};
+    int m_wordsPerRow = 0;
+    QVector<QVector<Word>> m_bands;
+    // Where each band's words are: in m_bands, or in memory held by m_owner.
+    QVector<const Word*> m_bandData;
+    std::shared_ptr<const void> m_owner;
+};
+
+#endif /* CELLBITSET_H_INCLUDED */
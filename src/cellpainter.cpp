@@ -11,7 +11,7 @@ void CellPainter::mouseMoveEvent(QEvent *event, boost::optional<QPoint> cell)
     if (m_paintPoint) {
         if (!cell) {
             QMouseEvent *mevent = static_cast<QMouseEvent*>(event);
-            cell = nearestValidCell(mevent->pos());
+            cell = view()->nearestCellAtPos(mevent->pos());
         }
 
         plotLine(*m_paintPoint, *cell);
@@ -34,31 +34,16 @@ void CellPainter::mouseReleaseEvent(QEvent *event, boost::optional<QPoint> cell)
     m_paintPoint.reset();
 }
 
-QPoint CellPainter::nearestValidCell(const QPoint& mousePosition) const
-{
-    Grid *grid = view()->grid();
-    QPoint p = view()->view()->mapToScene(mousePosition).toPoint();
-
-    if (p.x() < 0)
-        p.rx() = 0;
-    if (p.x() / GridView::RectSize >= grid->cols())
-        p.rx() = (grid->cols() - 1) * GridView::RectSize;
-    if (p.y() < 0)
-        p.ry() = 0;
-    if (p.y() / GridView::RectSize >= grid->rows())
-        p.ry() = (grid->rows() - 1) * GridView::RectSize;
-
-    return *view()->cellAtPos(view()->view()->mapFromScene(p));
-}
-
 void CellPainter::plotLine(const QPoint& from, const QPoint& to)
 {
+    Grid *grid = view()->grid();
     QPoint delta = to - from;
     int deltax = delta.x(), deltay = delta.y(),
         x = from.x(), y = from.y(),
         incx = x < to.x() ? 1 : -1,
         incy = y < to.y() ? 1 : -1;
 
+    grid->beginUpdate();
     if (deltax != 0) {
         double deltaerr = qAbs(double(deltay) / deltax);
         double error = deltaerr - 0.5;
@@ -78,6 +63,7 @@ void CellPainter::plotLine(const QPoint& from, const QPoint& to)
         plot({x, y});
         y += incy;
     }
+    grid->endUpdate();
 }
 
 void CellPainter::plot(const QPoint& cell)
@@ -14,7 +14,6 @@ public:
     virtual void mouseReleaseEvent(QEvent *event, boost::optional<QPoint> item) override;
 
 private:
-    QPoint nearestValidCell(const QPoint& mousePosition) const;
     void plotLine(const QPoint& from, const QPoint& to);
     void plot(const QPoint& cell);
 
@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <cmath>
+#include <QtAlgorithms>
+#include "cellrasterizer.h"
+
+// Every pixel covers a run of whole columns and rows of cells.  The live
+// cells of each row are scattered into per-pixel counters, so the cost is
+// proportional to the visible live cells rather than to the visible area.
+void CellRasterizer::render(const CellBitSet& cells, const QRectF& source, QImage& image)
+{
+    Q_ASSERT(image.format() == QImage::Format_Grayscale8);
+    const int width = image.width(), height = image.height();
+
+    auto cellBoundary = [] (qreal start, qreal extent, int pixels, int pixel, int limit) {
+        int ret = int(std::floor(start + extent * pixel / pixels));
+        return qBound(0, ret, limit);
+    };
+
+    m_colStart.resize(width + 1);
+    for (int px = 0; px <= width; ++px)
+        m_colStart[px] = cellBoundary(source.left(), source.width(), width, px, cells.cols());
+
+    const int firstCol = m_colStart[0], lastCol = m_colStart[width];
+    m_pixelOfColumn.resize(lastCol - firstCol);
+    for (int px = 0; px < width; ++px)
+        std::fill(m_pixelOfColumn.begin() + (m_colStart[px] - firstCol),
+                  m_pixelOfColumn.begin() + (m_colStart[px + 1] - firstCol), px);
+
+    m_counts.resize(width);
+    for (int py = 0; py < height; ++py) {
+        int top = cellBoundary(source.top(), source.height(), height, py, cells.rows());
+        int bottom = cellBoundary(source.top(), source.height(), height, py + 1, cells.rows());
+
+        std::fill(m_counts.begin(), m_counts.end(), 0);
+        for (int y = top; y < bottom; ++y) {
+            const CellBitSet::Word *row = cells.row(y);
+            for (int w = firstCol / CellBitSet::WordBits;
+                 w * CellBitSet::WordBits < lastCol; ++w) {
+                CellBitSet::Word bits = row[w];
+                while (bits != 0) {
+                    int x = w * CellBitSet::WordBits + qCountTrailingZeroBits(bits);
+                    bits &= bits - 1;
+                    if (x >= firstCol && x < lastCol)
+                        m_counts[m_pixelOfColumn[x - firstCol]]++;
+                }
+            }
+        }
+
+        uchar *line = image.scanLine(py);
+        for (int px = 0; px < width; ++px) {
+            int area = (m_colStart[px + 1] - m_colStart[px]) * (bottom - top);
+            line[px] = area == 0 ? 255 : uchar(255 - 255 * m_counts[px] / area);
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef CELLRASTERIZER_H_INCLUDED
+#define CELLRASTERIZER_H_INCLUDED
+
+#include <QImage>
+#include <QRectF>
+#include <QVector>
+#include "cellbitset.h"
+
+// Draws cells into grayscale images of at most one pixel per cell.  Each
+// pixel is shaded by the fraction of live cells it covers, from white for
+// none to black for all.  Keeps scratch buffers between calls, so one
+// rasterizer must not be used by several threads at once.
+class CellRasterizer
+{
+public:
+    // Draws the rectangle `source' of `cells', in cells, over all of
+    // `image', which must be in QImage::Format_Grayscale8.
+    void render(const CellBitSet& cells, const QRectF& source, QImage& image);
+
+private:
+    QVector<int> m_colStart;
+    QVector<int> m_pixelOfColumn;
+    QVector<int> m_counts;
+};
+
+#endif /* CELLRASTERIZER_H_INCLUDED */
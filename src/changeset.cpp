@@ -0,0 +1,36 @@
+#include <QtAlgorithms>
+#include "changeset.h"
+
+ChangeSet ChangeSet::difference(const CellBitSet& before, const CellBitSet& after)
+{
+    ChangeSet ret;
+
+    Q_ASSERT(before.size() == after.size());
+    for (int y = 0; y < before.rows(); ++y) {
+        if (y % CellBitSet::BandRows == 0 && before.bandShared(after, y / CellBitSet::BandRows)) {
+            y += CellBitSet::BandRows - 1;
+            continue;
+        }
+        ret.addRowDifference(before.row(y), after.row(y), before.wordsPerRow(),
+                             before.lastWordMask(), y);
+    }
+
+    return ret;
+}
+
+void ChangeSet::addRowDifference(const CellBitSet::Word *before, const CellBitSet::Word *after,
+                                 int words, CellBitSet::Word lastMask, int y)
+{
+    using Word = CellBitSet::Word;
+    constexpr int WordBits = CellBitSet::WordBits;
+
+    for (int i = 0; i < words; ++i) {
+        const Word mask = i == words - 1 ? lastMask : ~Word(0);
+        Word dead = before[i] & ~after[i] & mask, born = after[i] & ~before[i] & mask;
+
+        for (; dead; dead &= dead - 1)
+            died += QPoint(i * WordBits + qCountTrailingZeroBits(dead), y);
+        for (; born; born &= born - 1)
+            spawned += QPoint(i * WordBits + qCountTrailingZeroBits(born), y);
+    }
+}
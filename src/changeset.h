@@ -0,0 +1,54 @@
+#ifndef CHANGESET_H_INCLUDED
+#define CHANGESET_H_INCLUDED
+
+#include <QPoint>
+#include <QVector>
+#include "cellbitset.h"
+#include "grid.h"
+
+// Move-only, so that change sets handed between threads are never deep-copied
+// by accident.
+class ChangeSet
+{
+public:
+    ChangeSet() = default;
+    ChangeSet(ChangeSet&&) = default;
+    ChangeSet& operator=(ChangeSet&&) = default;
+
+    QVector<QPoint> died;
+    QVector<QPoint> spawned;
+
+    bool isEmpty() const { return died.isEmpty() && spawned.isEmpty(); }
+
+    // Empties the change set, keeping the allocated buffers for reuse.
+    void clear()
+    {
+        died.clear();
+        spawned.clear();
+    }
+
+    // The changes turning `from' into `to', which must be of the same size.
+    static ChangeSet difference(const CellBitSet& from, const CellBitSet& to);
+    static ChangeSet difference(const Grid& from, const Grid& to)
+    {
+        return difference(from.cells(), to.cells());
+    }
+
+    // Adds the changes between two versions of the packed row y.  Bits of
+    // the last word outside `lastMask' are ignored.
+    void addRowDifference(const CellBitSet::Word *before, const CellBitSet::Word *after,
+                          int words, CellBitSet::Word lastMask, int y);
+
+    void apply(Grid *grid)
+    {
+        grid->beginUpdate();
+        grid->setCellStatesAt(spawned, true);
+        grid->setCellStatesAt(died, false);
+        grid->endUpdate();
+    }
+
+private:
+    Q_DISABLE_COPY(ChangeSet)
+};
+
+#endif /* CHANGESET_H_INCLUDED */
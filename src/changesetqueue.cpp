@@ -0,0 +1,99 @@
+#include <QMutexLocker>
+#include "changesetqueue.h"
+
+ChangeSetQueue::ChangeSetQueue(int capacity)
+    : m_slots(capacity),
+      m_mask(quint32(capacity) - 1)
+{
+    Q_ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+}
+
+ChangeSet *ChangeSetQueue::reserve()
+{
+    const quint32 tail = m_tail.load();
+
+    if (tail - m_head.loadAcquire() == quint32(capacity()) && !isClosed()) {
+        m_producerStalls.fetchAndAddRelaxed(1);
+
+        QMutexLocker lock(&m_mutex);
+        m_producerWaiting.fetchAndStoreOrdered(1);
+        while (tail - m_head.loadAcquire() == quint32(capacity()) && !isClosed())
+            m_notFull.wait(&m_mutex);
+        m_producerWaiting.storeRelease(0);
+    }
+
+    if (isClosed())
+        return nullptr;
+
+    return &m_slots[tail & m_mask];
+}
+
+void ChangeSetQueue::commit()
+{
+    m_tail.fetchAndAddOrdered(1);
+    wake(m_consumerWaiting, m_notEmpty);
+}
+
+ChangeSet *ChangeSetQueue::front(unsigned long waitTime)
+{
+    const quint32 head = m_head.load();
+
+    if (m_tail.loadAcquire() == head) {
+        // Polling an empty ring is not a stall, only waiting on one is.
+        if (waitTime == 0 || isClosed())
+            return nullptr;
+        m_consumerStalls.fetchAndAddRelaxed(1);
+
+        QMutexLocker lock(&m_mutex);
+        m_consumerWaiting.fetchAndStoreOrdered(1);
+        while (m_tail.loadAcquire() == head && !isClosed()) {
+            if (!m_notEmpty.wait(&m_mutex, waitTime))
+                break;
+        }
+        m_consumerWaiting.storeRelease(0);
+
+        if (m_tail.loadAcquire() == head)
+            return nullptr;
+    }
+
+    return &m_slots[head & m_mask];
+}
+
+void ChangeSetQueue::release()
+{
+    m_head.fetchAndAddOrdered(1);
+    wake(m_producerWaiting, m_notFull);
+}
+
+void ChangeSetQueue::waitUntilEmpty()
+{
+    if (depth() == 0 || isClosed())
+        return;
+
+    QMutexLocker lock(&m_mutex);
+    m_producerWaiting.fetchAndStoreOrdered(1);
+    while (depth() != 0 && !isClosed())
+        m_notFull.wait(&m_mutex);
+    m_producerWaiting.storeRelease(0);
+}
+
+void ChangeSetQueue::close()
+{
+    m_closed.fetchAndStoreOrdered(1);
+
+    QMutexLocker lock(&m_mutex);
+    m_notFull.wakeAll();
+    m_notEmpty.wakeAll();
+}
+
+// The waiting flag is raised under the mutex before the sleeper re-checks the
+// ring, and the index has been published with a full barrier before the flag
+// is read here, so either the sleeper sees the new index or we see the flag.
+void ChangeSetQueue::wake(QAtomicInt& waiting, QWaitCondition& cond)
+{
+    if (waiting.loadAcquire() == 0)
+        return;
+
+    QMutexLocker lock(&m_mutex);
+    cond.wakeAll();
+}
@@ -0,0 +1,65 @@
+#ifndef CHANGESETQUEUE_H_INCLUDED
+#define CHANGESETQUEUE_H_INCLUDED
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QWaitCondition>
+#include <vector>
+#include "changeset.h"
+
+// Bounded single-producer, single-consumer ring of change sets.  Slots are
+// filled and consumed in place, so their buffers are reused instead of being
+// copied through the queue.  Indices are published with atomics; the mutex
+// and wait conditions are only touched when one side has to sleep.
+class ChangeSetQueue
+{
+public:
+    // `capacity' must be a power of two.
+    explicit ChangeSetQueue(int capacity);
+
+    // Producer side.  Returns the slot to fill, blocking while the ring is
+    // full, or nullptr once the queue is closed.  The slot is published by
+    // commit(); it may be reused as scratch if commit() is never called.
+    ChangeSet *reserve();
+    void commit();
+
+    // Consumer side.  Returns the oldest published slot, waiting up to
+    // `waitTime' milliseconds, or nullptr if there is none.  The slot stays
+    // valid until release().  Slots remain readable after close().
+    ChangeSet *front(unsigned long waitTime = 0);
+    void release();
+
+    // Blocks the producer until the consumer has taken every published slot
+    // or the queue is closed.
+    void waitUntilEmpty();
+
+    // Wakes both sides and makes reserve() fail from now on.
+    void close();
+    bool isClosed() const { return m_closed.loadAcquire() != 0; }
+
+    int capacity() const { return int(m_slots.size()); }
+    int depth() const { return int(m_tail.loadAcquire() - m_head.loadAcquire()); }
+    // Number of times the producer found the ring full and the consumer had
+    // to wait for it to fill.
+    quint64 producerStalls() const { return m_producerStalls.load(); }
+    quint64 consumerStalls() const { return m_consumerStalls.load(); }
+
+private:
+    void wake(QAtomicInt& waiting, QWaitCondition& cond);
+
+    std::vector<ChangeSet> m_slots;
+    const quint32 m_mask;
+    QAtomicInteger<quint32> m_head{0};
+    QAtomicInteger<quint32> m_tail{0};
+    QAtomicInt m_closed{0};
+    QAtomicInt m_producerWaiting{0};
+    QAtomicInt m_consumerWaiting{0};
+    QAtomicInteger<quint64> m_producerStalls{0};
+    QAtomicInteger<quint64> m_consumerStalls{0};
+    QMutex m_mutex;
+    QWaitCondition m_notFull;
+    QWaitCondition m_notEmpty;
+};
+
+#endif /* CHANGESETQUEUE_H_INCLUDED */
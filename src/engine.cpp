@@ -0,0 +1,69 @@
+#include <QObject>
+#include <QScopedPointer>
+#include "engine.h"
+#include "frontierengine.h"
+#include "grid.h"
+#include "hashlifeengine.h"
+#include "packedengine.h"
+#include "planeengine.h"
+#include "sparseengine.h"
+
+QVector<Engine::Type> Engine::types()
+{
+    return {Type::Packed, Type::Sparse, Type::Hashlife, Type::Frontier, Type::Unbounded};
+}
+
+Engine *Engine::create(Type type, const EngineOptions& options)
+{
+    switch (type) {
+    case Type::Packed: return new PackedEngine(options.threadCount);
+    case Type::Sparse: return new SparseEngine;
+    case Type::Hashlife: return new HashlifeEngine(qint64(options.hashlifeMemoryLimit) << 20);
+    case Type::Frontier: return new FrontierEngine;
+    case Type::Unbounded: return new PlaneEngine(options.plane);
+    }
+
+    Q_UNREACHABLE();
+}
+
+QString Engine::typeName(Type type)
+{
+    switch (type) {
+    case Type::Packed: return QObject::tr("Packed");
+    case Type::Sparse: return QObject::tr("Sparse");
+    case Type::Hashlife: return QObject::tr("Hashlife");
+    case Type::Frontier: return QObject::tr("Frontier");
+    case Type::Unbounded: return QObject::tr("Unbounded");
+    }
+
+    Q_UNREACHABLE();
+}
+
+QString Engine::describe(Type type, const EngineOptions& options)
+{
+    switch (type) {
+    case Type::Packed: return PackedEngine::describe(PackedKernel::active(), options.threadCount);
+    case Type::Sparse: return "sparse";
+    case Type::Hashlife: return "hashlife";
+    case Type::Frontier: return "frontier";
+    case Type::Unbounded: return PlaneEngine::describe();
+    }
+
+    Q_UNREACHABLE();
+}
+
+ChangeSet Engine::advance(const Grid& grid, quint64 generations)
+{
+    QScopedPointer<Grid> state(grid.clone());
+    ChangeSet changes;
+
+    QThread *thread = QThread::currentThread();
+    for (quint64 i = 0; i < generations && !thread->isInterruptionRequested(); ++i) {
+        nextGeneration(*state, changes);
+        if (changes.isEmpty() && !changedOffGrid())
+            break;
+        changes.apply(state.data());
+    }
+
+    return ChangeSet::difference(grid, *state);
+}
@@ -0,0 +1,58 @@
+#ifndef ENGINE_H_INCLUDED
+#define ENGINE_H_INCLUDED
+
+#include <QSharedPointer>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include "changeset.h"
+
+class Grid;
+class SparsePlane;
+
+// Settings for the engines; each engine picks the ones it needs.
+class EngineOptions
+{
+public:
+    int threadCount = QThread::idealThreadCount();
+    int hashlifeMemoryLimit = 512; // MiB
+    // Plane stepped by the unbounded engine, so that the cells outside the
+    // grid outlive the engine; a new one if null.
+    QSharedPointer<SparsePlane> plane;
+};
+
+// Computes successive generations of a grid.  Engines may keep state between
+// calls, so nextGeneration() must be given the grid the previously computed
+// ChangeSet was applied to.
+class Engine
+{
+public:
+    enum class Type { Packed, Sparse, Hashlife, Frontier, Unbounded };
+
+    static QVector<Type> types();
+    static Engine *create(Type type, const EngineOptions& options = EngineOptions());
+    static QString typeName(Type type);
+    // What name() of an engine created with these options returns, without
+    // creating one.
+    static QString describe(Type type, const EngineOptions& options = EngineOptions());
+
+    virtual ~Engine() = default;
+
+    virtual QString name() const = 0;
+    // Replaces the contents of `changes' with the changes leading to the next
+    // generation.  The buffers of `changes' are reused.
+    virtual void nextGeneration(const Grid& grid, ChangeSet& changes) = 0;
+    // Whether the last generation changed cells outside the grid, in which
+    // case an empty ChangeSet does not mean the pattern has settled.
+    virtual bool changedOffGrid() const { return false; }
+
+    // Returns the net change after the given number of generations.  The
+    // default steps through all of them.  Stops early, with the change so
+    // far, once the calling thread is asked to interrupt.
+    virtual ChangeSet advance(const Grid& grid, quint64 generations);
+    // Called instead of applying the result of advance() when the caller
+    // drops it.  Engines keeping state beside the grid undo the advance.
+    virtual void discardAdvance() { }
+};
+
+#endif /* ENGINE_H_INCLUDED */
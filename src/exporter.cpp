@@ -0,0 +1,223 @@
+#include <random>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QImageWriter>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QtDebug>
+#include "apngwriter.h"
+#include "cellrasterizer.h"
+#include "changeset.h"
+#include "exporter.h"
+#include "grid.h"
+
+namespace {
+    // Frames encoded by the pool, taken out in order by the stepping thread.
+    class EncodedFrames
+    {
+    public:
+        void add(int index, const QByteArray& png)
+        {
+            {
+                QMutexLocker lock(&m_mutex);
+                m_frames.insert(index, png);
+            }
+            m_cond.wakeAll();
+        }
+
+        // Waits for frame `index' to be encoded.
+        QByteArray take(int index)
+        {
+            QMutexLocker lock(&m_mutex);
+            while (!m_frames.contains(index))
+                m_cond.wait(&m_mutex);
+            return m_frames.take(index);
+        }
+
+    private:
+        QMutex m_mutex;
+        QWaitCondition m_cond;
+        QHash<int, QByteArray> m_frames;
+    };
+
+    // Rasterizes and compresses one frame.  The bit set shares its bands with
+    // the grid being stepped until the engine writes to them.
+    class FrameTask : public QRunnable
+    {
+    public:
+        FrameTask(const CellBitSet& cells, const QRect& region, const QSize& size, int index,
+                  EncodedFrames *frames)
+            : m_cells(cells),
+              m_region(region),
+              m_size(size),
+              m_index(index),
+              m_frames(frames)
+        { }
+
+        virtual void run() override
+        {
+            // Magnified frames are drawn at one pixel per cell and scaled up
+            // without smoothing, so that every cell stays a sharp square.
+            const QSize drawn = m_size.boundedTo(m_region.size());
+            QImage image(drawn, QImage::Format_Grayscale8);
+            CellRasterizer().render(m_cells, QRectF(m_region), image);
+            if (drawn != m_size)
+                image = image.scaled(m_size, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+
+            QBuffer buffer;
+            buffer.open(QIODevice::WriteOnly);
+            QImageWriter writer(&buffer, "png");
+            if (!writer.write(image))
+                qWarning() << "FrameTask::run:" << writer.errorString();
+            m_frames->add(m_index, buffer.data());
+        }
+
+    private:
+        CellBitSet m_cells;
+        QRect m_region;
+        QSize m_size;
+        int m_index;
+        EncodedFrames *m_frames;
+    };
+}
+
+int Exporter::run() const
+{
+    QTextStream out(stdout), err(stderr);
+    Grid grid(size);
+
+    if (!pattern.isEmpty()) {
+        QFile file(pattern);
+        Grid loaded({1, 1});
+        if (!file.open(QIODevice::ReadOnly) || !loaded.load(&file)) {
+            err << "Cannot read pattern " << pattern << ".\n";
+            return 1;
+        }
+
+        // Loading crops the grid to the pattern, which would leave nothing
+        // it emits any room to move.
+        CellBitSet cells(size.expandedTo(loaded.cells().size()));
+        const QPoint offset((cells.cols() - loaded.cols()) / 2,
+                            (cells.rows() - loaded.rows()) / 2);
+        for (const QPoint& cell : loaded)
+            cells.set(cell + offset, true);
+        grid.setCells(cells);
+    } else {
+        std::mt19937 random(seed);
+        std::bernoulli_distribution alive(density);
+        for (int y = 0; y < grid.rows(); ++y)
+            for (int x = 0; x < grid.cols(); ++x)
+                if (alive(random))
+                    grid.setCellStateAt({x, y}, true);
+    }
+
+    const QRect bounds(QPoint(0, 0), grid.cells().size());
+    const QRect shown = region.isNull() ? bounds : region.intersected(bounds);
+    if (shown.isEmpty()) {
+        err << "The export region lies outside the grid.\n";
+        return 1;
+    }
+    const QSize imageSize(qMax(1, qRound(shown.width() * scale)),
+                          qMax(1, qRound(shown.height() * scale)));
+
+    QFile animation(output);
+    ApngWriter apng(&animation, frameDelay);
+    if (format == Format::Apng && !animation.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        err << "Cannot write " << output << ": " << animation.errorString() << "\n";
+        return 1;
+    }
+
+    QString base = output;
+    if (base.endsWith(".png", Qt::CaseInsensitive))
+        base.chop(4);
+    const int digits = QString::number(generations).size();
+
+    QString error;
+    auto writeFrame = [&] (const QByteArray& png, int generation) {
+        if (format == Format::Apng) {
+            if (!apng.addFrame(png))
+                error = apng.errorString();
+            return error.isEmpty();
+        }
+
+        QFile file(QString("%1-%2.png").arg(base).arg(generation, digits, 10, QChar('0')));
+        if (png.isEmpty())
+            error = "frame encoding failed";
+        else if (!file.open(QIODevice::WriteOnly) || file.write(png) != png.size())
+            error = file.fileName() + ": " + file.errorString();
+        return error.isEmpty();
+    };
+
+    QScopedPointer<Engine> engine(Engine::create(engineType, engineOptions));
+    out << "engine: " << engine->name() << "\n"
+        << "region: " << shown.width() << "x" << shown.height() << "+" << shown.x()
+        << "+" << shown.y() << "\n"
+        << "frame size: " << imageSize.width() << "x" << imageSize.height() << "\n";
+    out.flush();
+
+    // Declared before the pool, whose destructor waits for the tasks.
+    EncodedFrames frames;
+    QThreadPool pool;
+    pool.setMaxThreadCount(encoderCount);
+    const int maxPending = maxPendingFrames > 0 ? maxPendingFrames : 2 * encoderCount;
+
+    // Frame i shows generation i * every, or the last one.
+    int submitted = 0, written = 0;
+    auto writeNext = [&] {
+        QByteArray png = frames.take(written);
+        if (error.isEmpty())
+            writeFrame(png, int(qMin(qint64(written) * every, qint64(generations))));
+        ++written;
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+
+    ChangeSet changes;
+    int generation = 0;
+    while (error.isEmpty()) {
+        if (submitted - written >= maxPending)
+            writeNext();
+        pool.start(new FrameTask(grid.cells(), shown, imageSize, submitted++, &frames));
+        if (generation >= generations)
+            break;
+
+        const int step = qMin(every, generations - generation);
+        if (step == 1)
+            engine->nextGeneration(grid, changes);
+        else
+            changes = engine->advance(grid, step);
+        // Nothing changing in one generation means a still life, which
+        // would only repeat the last frame.  No net change over several may
+        // be an oscillator whose period divides the step, so those go on.
+        if (step == 1 && changes.isEmpty() && !engine->changedOffGrid())
+            break;
+        changes.apply(&grid);
+        generation += step;
+    }
+
+    while (written < submitted)
+        writeNext();
+    if (error.isEmpty() && format == Format::Apng && !apng.finish())
+        error = apng.errorString();
+
+    if (!error.isEmpty()) {
+        err << "Export failed: " << error << "\n";
+        return 1;
+    }
+
+    double seconds = timer.nsecsElapsed() / 1e9;
+    out << "generations: " << generation << "\n"
+        << "frames: " << written << "\n"
+        << "seconds: " << seconds << "\n"
+        << "frames/s: " << (seconds > 0 ? written / seconds : 0) << "\n";
+    return 0;
+}
@@ -0,0 +1,49 @@
+#ifndef EXPORTER_H_INCLUDED
+#define EXPORTER_H_INCLUDED
+
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include "engine.h"
+
+// Steps a pattern without a GUI and writes every Nth generation as an image:
+// an animated PNG, or one PNG file per frame.  Frames are rasterized and
+// compressed on a thread pool while the engine keeps stepping, and written
+// in order as they are done.  At most maxPendingFrames are in flight, so
+// memory stays bounded however long the run.
+class Exporter
+{
+public:
+    enum class Format { Apng, PngSequence };
+
+    Engine::Type engineType = Engine::Type::Packed;
+    EngineOptions engineOptions;
+    // Pattern to start from, in any PatternFormat, centred in a grid of
+    // `size' or larger if it does not fit; a random soup of `size' if empty.
+    QString pattern;
+    QSize size{512, 512};
+    double density = 0.5;
+    quint32 seed = 1;
+
+    // The animation, or the name the numbered files are derived from:
+    // "run.png" gives "run-0000.png", "run-0010.png" and so on, numbered by
+    // generation.
+    QString output;
+    Format format = Format::Apng;
+    int generations = 100;
+    int every = 1;
+    // Image pixels per cell.  Below 1, each pixel is shaded by the fraction
+    // of live cells it covers.
+    double scale = 1;
+    // Cells shown; the whole grid if null.
+    QRect region;
+    // Milliseconds each frame of an animation is shown.
+    int frameDelay = 100;
+    int encoderCount = QThread::idealThreadCount();
+    // Twice the encoder count if zero.
+    int maxPendingFrames = 0;
+
+    int run() const;
+};
+
+#endif /* EXPORTER_H_INCLUDED */
@@ -0,0 +1,87 @@
+#include <QMutexLocker>
+#include "framerenderer.h"
+
+FrameRenderer::FrameRenderer(QObject *parent)
+    : QThread(parent)
+{
+    start(LowPriority);
+}
+
+FrameRenderer::~FrameRenderer()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_quit = true;
+    }
+    m_cond.wakeOne();
+    wait();
+}
+
+void FrameRenderer::requestFrame(const CellBitSet& cells, const QRectF& source, const QSize& size)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_request = Request{cells, source, size};
+    }
+    m_cond.wakeOne();
+}
+
+const FrameRenderer::Frame *FrameRenderer::latestFrame()
+{
+    if (m_middle.load() & FreshBit)
+        m_front = m_middle.fetchAndStoreOrdered(m_front) & IndexMask;
+
+    const Frame& frame = m_frames[m_front];
+    return frame.image.isNull() ? nullptr : &frame;
+}
+
+void FrameRenderer::clear()
+{
+    // Frames still being rendered are from before the clear and are dropped
+    // on publication, which is checked under the same lock.
+    {
+        QMutexLocker lock(&m_mutex);
+        m_request = boost::none;
+        m_generation.fetchAndAddOrdered(1);
+        m_middle.fetchAndAndOrdered(IndexMask);
+    }
+    m_frames[m_front] = Frame();
+}
+
+void FrameRenderer::run()
+{
+    while (true) {
+        Request request;
+        int generation;
+        {
+            QMutexLocker lock(&m_mutex);
+            while (!m_quit && !m_request)
+                m_cond.wait(&m_mutex);
+            if (m_quit)
+                return;
+
+            request = std::move(*m_request);
+            m_request = boost::none;
+            generation = m_generation.load();
+        }
+
+        render(request, m_frames[m_back]);
+        {
+            QMutexLocker lock(&m_mutex);
+            if (generation != m_generation.load())
+                continue;
+            m_back = m_middle.fetchAndStoreOrdered(m_back | FreshBit) & IndexMask;
+        }
+        emit frameReady();
+    }
+}
+
+void FrameRenderer::render(const Request& request, Frame& frame)
+{
+    if (frame.image.size() != request.size)
+        frame.image = QImage(request.size, QImage::Format_Grayscale8);
+    frame.source = request.source;
+    frame.size = request.size;
+
+    m_rasterizer.render(request.cells, request.source, frame.image);
+}
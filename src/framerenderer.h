@@ -0,0 +1,79 @@
+#ifndef FRAMERENDERER_H_INCLUDED
+#define FRAMERENDERER_H_INCLUDED
+
+#include <QAtomicInt>
+#include <QImage>
+#include <QMutex>
+#include <QRectF>
+#include <QThread>
+#include <QWaitCondition>
+#include <boost/optional.hpp>
+#include "cellbitset.h"
+#include "cellrasterizer.h"
+
+// Rasterizes zoomed-out views of a grid on its own thread.  Each pixel of a
+// frame is shaded by the fraction of live cells it covers.  Finished frames
+// are handed to the GUI thread through a triple buffer, so neither side ever
+// waits for the other: the renderer always has a free buffer to draw into
+// and the GUI always has the newest complete frame to show.
+class FrameRenderer : public QThread
+{
+    Q_OBJECT
+public:
+    struct Frame
+    {
+        QImage image;
+        // Rectangle of the grid shown, in cells, and the frame size in
+        // device pixels.
+        QRectF source;
+        QSize size;
+    };
+
+    FrameRenderer(QObject *parent = nullptr);
+    virtual ~FrameRenderer();
+
+    // Asks for a frame of `source' from `cells' at `size' device pixels.
+    // Requests not yet picked up by the renderer are replaced.
+    void requestFrame(const CellBitSet& cells, const QRectF& source, const QSize& size);
+
+    // The newest finished frame, or nullptr if there is none yet.  Must only
+    // be called from the GUI thread; the frame stays valid until the next
+    // call or clear().
+    const Frame *latestFrame();
+
+    // Drops all frames, e.g. when the grid is resized.
+    void clear();
+
+signals:
+    void frameReady();
+
+protected:
+    virtual void run() override;
+
+private:
+    struct Request
+    {
+        CellBitSet cells;
+        QRectF source;
+        QSize size;
+    };
+
+    enum { IndexMask = 3, FreshBit = 4 };
+
+    void render(const Request& request, Frame& frame);
+
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    boost::optional<Request> m_request;
+    bool m_quit = false;
+
+    Frame m_frames[3];
+    int m_back = 0;
+    int m_front = 2;
+    QAtomicInt m_middle{1};
+    QAtomicInt m_generation{0};
+
+    CellRasterizer m_rasterizer;
+};
+
+#endif /* FRAMERENDERER_H_INCLUDED */
@@ -0,0 +1,46 @@
+#include "frontierengine.h"
+#include "grid.h"
+
+void FrontierEngine::nextGeneration(const Grid& grid, ChangeSet& changes)
+{
+    changes.clear();
+
+    if (!m_started || m_visited.size() != grid.cells().size()) {
+        m_visited = CellBitSet(grid.cells().size());
+        m_frontier.clear();
+        for (const QPoint& cell : grid)
+            m_frontier += cell;
+        m_started = true;
+    }
+
+    m_candidates.clear();
+    for (const QPoint& cell : m_frontier)
+        for (int dy = -1; dy <= 1; ++dy)
+            for (int dx = -1; dx <= 1; ++dx) {
+                QPoint candidate = cell + QPoint(dx, dy);
+                if (m_visited.contains(candidate) && !m_visited.test(candidate)) {
+                    m_visited.set(candidate, true);
+                    m_candidates += candidate;
+                }
+            }
+
+    for (const QPoint& cell : m_candidates) {
+        int count = 0;
+        for (int dy = -1; dy <= 1; ++dy)
+            for (int dx = -1; dx <= 1; ++dx)
+                if ((dx || dy) && grid.stateAt(cell + QPoint(dx, dy)))
+                    ++count;
+
+        bool alive = grid.stateAt(cell);
+        if (alive && (count < 2 || count > 3))
+            changes.died += cell;
+        else if (!alive && count == 3)
+            changes.spawned += cell;
+
+        m_visited.set(cell, false);
+    }
+
+    m_frontier.clear();
+    m_frontier += changes.died;
+    m_frontier += changes.spawned;
+}
@@ -0,0 +1,25 @@
+#ifndef FRONTIERENGINE_H_INCLUDED
+#define FRONTIERENGINE_H_INCLUDED
+
+#include <QVector>
+#include "cellbitset.h"
+#include "engine.h"
+
+// Only re-evaluates cells within distance 1 of the cells that changed in the
+// previous generation, since no other cell can change.  Still lifes cost
+// nothing once settled, so a step costs O(activity) rather than
+// O(population).  The first step treats every live cell as changed.
+class FrontierEngine : public Engine
+{
+public:
+    virtual QString name() const override { return describe(Type::Frontier); }
+    virtual void nextGeneration(const Grid& grid, ChangeSet& changes) override;
+
+private:
+    QVector<QPoint> m_frontier;
+    CellBitSet m_visited;
+    QVector<QPoint> m_candidates;
+    bool m_started = false;
+};
+
+#endif /* FRONTIERENGINE_H_INCLUDED */
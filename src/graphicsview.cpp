@@ -1,9 +1,14 @@
 #include <QWheelEvent>
 #include "graphicsview.h"
 
+namespace {
+    // Tolerance for zoom factors accumulated from repeated wheel steps.
+    constexpr qreal ZoomEpsilon = 0.001;
+}
+
 void GraphicsView::setZoomFactor(qreal factor)
 {
-    if (factor < 0.1 || factor > 2.05)
+    if (factor < MinZoomFactor - ZoomEpsilon || factor > MaxZoomFactor)
         return;
 
     QTransform transform;
@@ -19,9 +24,9 @@ void GraphicsView::wheelEvent(QWheelEvent *event)
     qreal newScale, curScale = zoomFactor();
 
     if (event->delta() > 0)
-        newScale = curScale + 0.1;
+        newScale = curScale + (curScale > FineZoomFactor - ZoomEpsilon ? 0.1 : 0.01);
     else
-        newScale = curScale - 0.1;
+        newScale = curScale - (curScale > FineZoomFactor + ZoomEpsilon ? 0.1 : 0.01);
 
     setZoomFactor(newScale);
 }
@@ -9,6 +9,11 @@ class GraphicsView : public QGraphicsView
 public:
     using QGraphicsView::QGraphicsView;
 
+    static constexpr qreal MinZoomFactor = 0.01;
+    static constexpr qreal MaxZoomFactor = 2.05;
+    // Below this zoom factor the mouse wheel zooms in finer steps.
+    static constexpr qreal FineZoomFactor = 0.1;
+
     qreal zoomFactor() const { return transform().m22(); }
 
 public slots:
@@ -1,15 +1,11 @@
 #include <boost/functional/hash.hpp>
+#include <QBuffer>
 #include <QDebug>
+#include <QMetaMethod>
+#include <QtAlgorithms>
 #include "grid.h"
-
-template <typename Container>
-void writePoints(const Container& points, QTextStream& stream)
-{
-    stream << points.size();
-    for (const QPoint& pt : points)
-        stream << "\n" << pt.x() << " " << pt.y();
-    stream << "\n";
-}
+#include "patternreader.h"
+#include "patternwriter.h"
 
 uint qHash(const QPoint& key)
 {
@@ -24,33 +20,22 @@ std::size_t std::hash<QPoint>::operator()(const QPoint& key) const
     return seed;
 }
 
-namespace {
-    int readUnsignedInt(QTextStream& stream)
-    {
-        int ret;
-        QString str;
-        bool ok;
-
-        stream >> str;
-        ret = str.toInt(&ok);
-
-        if (!ok)
-            stream.setStatus(QTextStream::ReadCorruptData);
-        return ret;
-    }
-}
-
 Grid::Grid(const QSize& size, QObject *parent)
     : QObject(parent)
 {
     setSize(size);
 }
 
+Grid::Grid(const CellBitSet& cells)
+    : m_cells(cells),
+      m_size(cells.size())
+{ }
+
 Grid * Grid::clone() const
 {
-    Grid *ret = new Grid(m_size);
-    ret->m_activeCells = m_activeCells;
-    // data not copied.
+    // Shares the cell storage until either grid writes to it.
+    Grid *ret = new Grid(m_cells);
+    ret->m_size = m_size;
     return ret;
 }
 
@@ -59,172 +44,183 @@ void Grid::copyStateFrom(const Grid *grid)
     if (!grid->isValid())
         return;
     setSize(grid->m_size);
-    auto oldcells = m_activeCells;
-    for (auto&& cell : oldcells)
-        setCellStateAt(cell, false);
-    for (auto&& cell : *grid)
-        setCellStateAt(cell, true);
+
+    // Only the cells that differ change; they are found word by word in the
+    // bands the two grids do not share.
+    const CellBitSet& before = m_cells;
+    const CellBitSet& after = grid->m_cells;
+    beginUpdate();
+    for (int y = 0; y < rows(); ++y) {
+        if (y % CellBitSet::BandRows == 0 && before.bandShared(after, y / CellBitSet::BandRows)) {
+            y += CellBitSet::BandRows - 1;
+            continue;
+        }
+
+        const CellBitSet::Word *from = before.row(y), *to = after.row(y);
+        const int words = before.wordsPerRow();
+        for (int w = 0; w < words; ++w) {
+            CellBitSet::Word diff = from[w] ^ to[w];
+            if (w == words - 1)
+                diff &= before.lastWordMask();
+            for (; diff != 0; diff &= diff - 1) {
+                int x = w * CellBitSet::WordBits + qCountTrailingZeroBits(diff);
+                m_changedCells += QPoint(x, y);
+            }
+        }
+    }
+    m_cells = after;
+    endUpdate();
 }
 
-void Grid::setSize(const QSize& size)
+void Grid::endUpdate()
 {
-    Q_ASSERT(size.isValid() && size.width() * size.height() != 0);
-    if (size == m_size)
+    Q_ASSERT(m_updateDepth > 0);
+    if (--m_updateDepth > 0 || m_changedCells.isEmpty())
         return;
-    if (!isValid())
-        m_size = {0, 0};
-    int rows = size.height(), cols = size.width();
 
-    if (cols > this->cols())
-        m_data.resize(cols);
-
-    while (cols > this->cols()) {
-        m_size.rwidth()++;
-        emit columnAdded();
-    }
-
-    while (cols < this->cols()) {
-        m_size.rwidth()--;
-        emit columnRemoved();
-        for (int i = 0; i < this->rows(); ++i) {
-            m_activeCells -= {this->cols(), i};
-            m_data[this->cols()].remove(i);
-        }
-    }
+    emit cellStatesChanged(m_changedCells);
+    m_changedCells.clear();
+}
 
-    m_data.resize(cols);
+void Grid::cellChanged(const QPoint& cell)
+{
+    if (m_updateDepth > 0)
+        m_changedCells += cell;
+    else
+        emit cellStateChanged(cell, stateAt(cell));
+}
 
-    while (rows > this->rows()) {
-        m_size.rheight()++;
-        emit rowAdded();
-    }
+void Grid::setSize(const QSize& size)
+{
+    Q_ASSERT(size.isValid() && size.width() * size.height() != 0);
+    if (size == m_size)
+        return;
 
-    while (rows < this->rows()) {
-        m_size.rheight()--;
-        emit rowRemoved();
-        for (int i = 0; i < this->cols(); ++i) {
-            m_activeCells -= {i, this->rows()};
-            m_data[i].remove(this->rows());
-        }
-    }
+    // Cells outside the new bounds are cropped as the storage is resized.
+    m_cells.resize(size);
 
-    emit sizeChanged(m_size);
+    QSize oldSize = m_size;
+    m_size = size;
+    emit sizeChanged(oldSize, m_size);
 }
 
 void Grid::setCellStateAt(const QPoint& cell, bool state)
 {
-    if (stateAt(cell) == state)
+    if (!m_cells.contains(cell) || stateAt(cell) == state)
         return;
 
-    if (state)
-        m_activeCells += cell;
-    else
-        m_activeCells -= cell;
-
-    emit cellStateChanged(cell, state);
+    m_cells.set(cell, state);
+    cellChanged(cell);
 }
 
-void Grid::setCellDataAt(const QPoint& cell, const QVariant& data)
+void Grid::setCellStatesAt(const QVector<QPoint>& cells, bool state)
 {
-    m_data[cell.x()].insert(cell.y(), data);
+    beginUpdate();
+    for (const QPoint& cell : cells)
+        setCellStateAt(cell, state);
+    endUpdate();
 }
 
 void Grid::clear()
 {
-    auto state = m_activeCells;
-    for (const QPoint& cell : state)
-        setCellStateAt(cell, false);
+    beginUpdate();
+    for (const QPoint& cell : m_cells)
+        m_changedCells += cell;
+    m_cells.clear();
+    endUpdate();
 }
 
 void Grid::invalidate()
 {
-    while (cols() > 0) {
-        m_size.rwidth()--;
-        emit columnRemoved();
-    }
-    while (rows() > 0) {
-        m_size.rheight()--;
-        emit rowRemoved();
-    }
     m_size = {-1, -1};
-    m_data.clear();
-    m_activeCells.clear();
+    m_cells = CellBitSet();
 }
 
-QTextStream& operator<<(QTextStream& out, const Grid& grid)
+bool Grid::load(QIODevice *device, PatternFormat format)
 {
-    if (grid.m_activeCells.isEmpty())
-        return out << 1 << " " << 1 << "\n" << 0 << "\n";
-
-    int maxX = 0, minX = INT_MAX, maxY = 0, minY = INT_MAX;
-    for (const QPoint& pt : grid.m_activeCells) {
-        if (pt.x() > maxX)
-            maxX = pt.x();
-        if (pt.x() < minX)
-            minX = pt.x();
-        if (pt.y() > maxY)
-            maxY = pt.y();
-        if (pt.y() < minY)
-            minY = pt.y();
+    PatternReader reader(device);
+    CellBitSet cells;
+
+    if (!reader.read(cells, format)) {
+        qWarning() << "Grid::load:" << reader.errorString();
+        return false;
     }
 
-    QSet<QPoint> activeCells;
-    for (const QPoint& pt : grid.m_activeCells)
-        activeCells += pt - QPoint{minX, minY};
+    setCells(cells);
+    return true;
+}
+
+void Grid::setCells(const CellBitSet& cells)
+{
+    // With nobody watching the cells there is no need to find the ones that
+    // changed, which would read a mapped snapshot in full.
+    if (!isSignalConnected(QMetaMethod::fromSignal(&Grid::cellStateChanged))
+        && !isSignalConnected(QMetaMethod::fromSignal(&Grid::cellStatesChanged))) {
+        QSize oldSize = m_size;
+        m_cells = cells;
+        m_size = cells.size();
+        if (m_size != oldSize)
+            emit sizeChanged(oldSize, m_size);
+        return;
+    }
 
-    int cols = maxX - minX + 1, rows = maxY - minY + 1;
-    out << cols << " " << rows << "\n";
-    writePoints(activeCells, out);
-    return out << "\n";
+    Grid other(cells);
+    copyStateFrom(&other);
 }
 
-QTextStream& operator>>(QTextStream& out, Grid& grid)
+bool Grid::save(QIODevice *device, PatternFormat format) const
 {
-    int cols = readUnsignedInt(out);
-    int rows = readUnsignedInt(out);
+    return PatternWriter(device).write(m_cells, format);
+}
 
-    grid.clear();
-    if (out.status() != QTextStream::Ok
-        || cols <= 0 || rows <= 0) {
-        qWarning() << "Read corrupted data or IO error occurred: size read = {"
-                   << cols << "," << rows << "}, stream status = " << out.status();
-        grid.invalidate();
+// The stream operators use the native format.  They bypass the text codec
+// and go through PatternReader and PatternWriter on the underlying bytes.
+QTextStream& operator<<(QTextStream& out, const Grid& grid)
+{
+    if (QIODevice *device = out.device()) {
+        out.flush();
+        if (!grid.save(device))
+            out.setStatus(QTextStream::WriteFailed);
         return out;
     }
 
-    Grid g({cols, rows});
-    g.readPoints(out);
-    if (!g.isValid()) {
-        out.setStatus(QTextStream::ReadCorruptData);
-        grid.invalidate();
-        return out;
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    grid.save(&buffer);
+    return out << QString::fromLatin1(buffer.data());
+}
+
+QTextStream& operator>>(QTextStream& in, Grid& grid)
+{
+    // Seekable devices are parsed in place from the stream's position, which
+    // is moved past the pattern afterwards.  Anything else is taken whole.
+    QIODevice *device = in.device();
+    QBuffer buffer;
+    qint64 start = in.pos();
+
+    if (device && !device->isSequential() && start >= 0) {
+        device->seek(start);
+    } else {
+        buffer.setData(in.readAll().toLatin1());
+        buffer.open(QIODevice::ReadOnly);
+        device = &buffer;
+        start = -1;
     }
 
-    grid.copyStateFrom(&g);
-    return out;
-}
-
-void Grid::readPoints(QTextStream& stream)
-{
-    bool valid = true;
-    int n = readUnsignedInt(stream);
-    if (n <= 0)
-        valid = false;
-    while (n-- > 0 && stream.status() == QTextStream::Ok) {
-        int x = readUnsignedInt(stream);
-        int y = readUnsignedInt(stream);
-        if (stream.status() != QTextStream::Ok
-            || x < 0 || y < 0 || x >= cols() || y >= rows()) {
-            qWarning() << "Read corrupted data or IO error occurred: point = {"
-                       << x << "," << y
-                       << "}, grid size = " << m_size
-                       << "), stream status = " << stream.status();
-            valid = false;
-            break;
-        }
-        m_activeCells += QPoint{x, y};
+    PatternReader reader(device);
+    CellBitSet cells;
+    bool ok = reader.read(cells, PatternFormat::Native);
+    if (start >= 0)
+        in.seek(start + reader.bytesRead());
+
+    if (!ok) {
+        qWarning() << "Read corrupted data or IO error occurred:" << reader.errorString();
+        in.setStatus(QTextStream::ReadCorruptData);
+        grid.invalidate();
+        return in;
     }
 
-    if (!valid || stream.status() != QTextStream::Ok)
-        invalidate();
+    Grid loaded(cells);
+    grid.copyStateFrom(&loaded);
+    return in;
 }
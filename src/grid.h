@@ -3,15 +3,17 @@
 
 #include <functional>
 #include <QObject>
-#include <QSet>
 #include <QPoint>
 #include <QHash>
-#include <QVariant>
 #include <QVector>
 #include <QTextStream>
 #include <QtGlobal>
 #include <QSize>
+#include "cellbitset.h"
 #include "gridcellneighbouriterator.h"
+#include "patternformat.h"
+
+class QIODevice;
 
 uint qHash(const QPoint& key);
 
@@ -36,25 +38,25 @@ public slots:
     void setSize(int rows, int cols) { setSize({cols, rows}); }
     void setSize(const QSize& size);
     void setCellStateAt(const QPoint& cell, bool state);
-    void setCellDataAt(const QPoint& cell, const QVariant& data);
+    void setCellStatesAt(const QVector<QPoint>& cells, bool state);
     void clear();
 
 signals:
-    void columnAdded();
-    void columnRemoved();
-    void rowAdded();
-    void rowRemoved();
     void cellStateChanged(const QPoint& cell, bool state);
-    void sizeChanged(const QSize& newSize);
+    // Emitted instead of cellStateChanged() for the cells changed between
+    // beginUpdate() and endUpdate(); their new states are in the grid.
+    void cellStatesChanged(const QVector<QPoint>& cells);
+    void sizeChanged(const QSize& oldSize, const QSize& newSize);
 
 public:
     bool isValid() const { return m_size.isValid() && rows() * cols() != 0; }
-    bool stateAt(const QPoint& cell) const { return m_activeCells.contains(cell); }
-    QVariant dataAt(const QPoint& cell) const { return m_data[cell.x()][cell.y()]; }
+    bool stateAt(const QPoint& cell) const { return m_cells.test(cell); }
     int cols() const { return m_size.width(); }
     int rows() const { return m_size.height(); }
-    QSet<QPoint>::const_iterator begin() const { return m_activeCells.begin(); }
-    QSet<QPoint>::const_iterator end() const { return m_activeCells.end(); }
+    int population() const { return m_cells.count(); }
+    const CellBitSet& cells() const { return m_cells; }
+    CellBitSet::const_iterator begin() const { return m_cells.begin(); }
+    CellBitSet::const_iterator end() const { return m_cells.end(); }
     GridCellNeighbourIterator neighbourIterator(const QPoint& cell) const
     {
         return { cell, {cols(), rows()} };
@@ -62,17 +64,32 @@ public:
 
     Grid *clone() const;
     void copyStateFrom(const Grid *grid);
+    // Replaces the whole grid with `cells', resizing it to match.
+    void setCells(const CellBitSet& cells);
+
+    // Batches cell state changes into a single cellStatesChanged() signal,
+    // emitted when the outermost batch ends.  Batches may nest.
+    void beginUpdate() { ++m_updateDepth; }
+    void endUpdate();
+
+    // Replaces the grid with a pattern read from a device, resizing it to
+    // the pattern.  The grid is left alone if reading fails.
+    bool load(QIODevice *device, PatternFormat format = PatternFormat::Auto);
+    // Writes the bounding box of the live cells.
+    bool save(QIODevice *device, PatternFormat format = PatternFormat::Native) const;
 
     friend QTextStream& operator<<(QTextStream& out, const Grid& grid);
     friend QTextStream& operator>>(QTextStream& out, Grid& grid);
 
 private:
+    explicit Grid(const CellBitSet& cells);
     void invalidate();
-    void readPoints(QTextStream& stream);
+    void cellChanged(const QPoint& cell);
 
-    QSet<QPoint> m_activeCells;
-    QVector<QHash<int, QVariant>> m_data;
+    CellBitSet m_cells;
     QSize m_size;
+    int m_updateDepth = 0;
+    QVector<QPoint> m_changedCells;
 };
 
 Q_DECLARE_METATYPE(Grid*)
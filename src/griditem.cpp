@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cmath>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QTimer>
+#include "griditem.h"
+#include "grid.h"
+#include "framerenderer.h"
+
+namespace {
+    enum CellColorIndex { DeadIndex = 0, AliveIndex = 1 };
+}
+
+GridItem::GridItem(const Grid *grid, QGraphicsItem *parent)
+    : QGraphicsObject(parent),
+      m_grid(grid),
+      m_flushTimer(new QTimer(this)),
+      m_renderer(new FrameRenderer(this))
+{
+    setFlag(ItemUsesExtendedStyleOption);
+    // Keeps overlays such as template previews inside the grid.
+    setFlag(ItemClipsChildrenToShape);
+
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(0);
+    connect(m_flushTimer, SIGNAL(timeout()), this, SLOT(flushDirty()));
+    connect(m_renderer, SIGNAL(frameReady()), this, SLOT(onFrameReady()));
+}
+
+QRect GridItem::cellRect(const QPoint& cell) const
+{
+    return cellsRect({cell, QSize(1, 1)});
+}
+
+QRect GridItem::cellsRect(const QRect& cells) const
+{
+    return {cells.topLeft() * CellSize, cells.size() * CellSize};
+}
+
+void GridItem::reset()
+{
+    const Grid& grid = *m_grid;
+    QSize size(grid.cols(), grid.rows());
+    if (size != m_image.size()) {
+        prepareGeometryChange();
+        m_image = QImage(size, QImage::Format_Mono);
+        m_image.setColorTable({qRgb(255, 255, 255), qRgb(0, 0, 0)});
+        m_renderer->clear();
+        m_requestedSize = QSize();
+    }
+
+    rebuildImage();
+    m_frameOutdated = true;
+    update();
+}
+
+void GridItem::rebuildImage()
+{
+    m_image.fill(DeadIndex);
+    for (const QPoint& cell : *m_grid)
+        m_image.setPixel(cell, AliveIndex);
+    resetMipLevels();
+    resetDirty();
+    m_stale = false;
+}
+
+void GridItem::resetMipLevels()
+{
+    const Grid& grid = *m_grid;
+
+    m_levels.clear();
+
+    for (int shift = 1; shift <= MaxMipLevels; ++shift) {
+        const int block = 1 << shift;
+        QSize size((grid.cols() + block - 1) >> shift, (grid.rows() + block - 1) >> shift);
+
+        MipLevel level{shift, QImage(size, QImage::Format_Grayscale8), {}};
+        level.counts.fill(0, size.width() * size.height());
+        for (const QPoint& cell : grid)
+            level.counts[(cell.y() >> shift) * size.width() + (cell.x() >> shift)]++;
+        for (int y = 0; y < size.height(); ++y)
+            for (int x = 0; x < size.width(); ++x)
+                updateBlock(level, {x, y});
+        m_levels += level;
+
+        // Coarser levels would not be any smaller on screen.
+        if (size.width() <= 1 && size.height() <= 1)
+            break;
+    }
+}
+
+// Shades a block by its live cell density; blocks on the far edges may hold
+// fewer than 2^k x 2^k cells.
+void GridItem::updateBlock(MipLevel& level, const QPoint& block)
+{
+    const int side = 1 << level.shift;
+    int width = std::min(side, m_image.width() - block.x() * side);
+    int height = std::min(side, m_image.height() - block.y() * side);
+    int count = level.counts[block.y() * level.image.width() + block.x()];
+
+    level.image.scanLine(block.y())[block.x()] = uchar(255 - 255 * count / (width * height));
+}
+
+void GridItem::setCellState(const QPoint& cell, bool state)
+{
+    if (m_rendering) {
+        // The next frame is rendered from the grid itself.
+        m_stale = m_frameOutdated = true;
+        if (!m_flushTimer->isActive())
+            m_flushTimer->start();
+        return;
+    }
+
+    if (!m_image.valid(cell) || bool(m_image.pixelIndex(cell)) == state)
+        return;
+
+    m_image.setPixel(cell, state ? AliveIndex : DeadIndex);
+    for (MipLevel& level : m_levels) {
+        QPoint block(cell.x() >> level.shift, cell.y() >> level.shift);
+        level.counts[block.y() * level.image.width() + block.x()] += state ? 1 : -1;
+        updateBlock(level, block);
+    }
+    markDirty(cell);
+}
+
+void GridItem::markDirty(const QPoint& cell)
+{
+    const int tilesPerRow = (m_image.width() + DirtyTileSize - 1) / DirtyTileSize;
+    int tile = cell.y() / DirtyTileSize * tilesPerRow + cell.x() / DirtyTileSize;
+    QRect dirty(cell, QSize(1, 1));
+
+    if (m_dirtyList.isEmpty())
+        m_flushTimer->start();
+    if (m_dirtyTiles[tile].isNull())
+        m_dirtyList += tile;
+    m_dirtyTiles[tile] |= dirty;
+    m_dirtyBounds |= dirty;
+}
+
+void GridItem::resetDirty()
+{
+    const int tiles = ((m_image.width() + DirtyTileSize - 1) / DirtyTileSize)
+        * ((m_image.height() + DirtyTileSize - 1) / DirtyTileSize);
+
+    m_dirtyTiles.fill(QRect(), tiles);
+    m_dirtyList.clear();
+    m_dirtyBounds = QRect();
+    m_flushTimer->stop();
+}
+
+void GridItem::flushDirty()
+{
+    if (m_rendering && m_frameOutdated && m_requestedSize.isValid()) {
+        m_renderer->requestFrame(m_grid->cells(), m_requestedSource, m_requestedSize);
+        m_frameOutdated = false;
+    }
+
+    if (m_dirtyList.size() > MaxDirtyRects)
+        update(cellsRect(m_dirtyBounds));
+    else {
+        for (int tile : m_dirtyList)
+            update(cellsRect(m_dirtyTiles[tile]));
+    }
+
+    for (int tile : m_dirtyList)
+        m_dirtyTiles[tile] = QRect();
+    m_dirtyList.clear();
+    m_dirtyBounds = QRect();
+}
+
+void GridItem::onFrameReady()
+{
+    if (m_rendering)
+        update();
+}
+
+QRectF GridItem::boundingRect() const
+{
+    // Leave room for the cosmetic grid line pen on the far edges.
+    return QRectF(QPointF(0, 0), QSizeF(m_image.size() * CellSize)).adjusted(-1, -1, 1, 1);
+}
+
+void GridItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    if (m_image.isNull())
+        return;
+
+    // Use the finest level whose blocks still cover a whole device pixel.
+    qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    int level = 0;
+    while (level < m_levels.size() && scale * (CellSize << level) < 1)
+        ++level;
+
+    m_rendering = level > 0 && widget != nullptr;
+    if (m_rendering && drawRenderedFrame(painter, widget))
+        return;
+    if (m_stale)
+        rebuildImage();
+
+    // Only the cells touched by the exposed rectangle are converted and drawn.
+    QRectF exposed = option->exposedRect;
+    int left = std::max(0, int(std::floor(exposed.left() / CellSize)));
+    int top = std::max(0, int(std::floor(exposed.top() / CellSize)));
+    int right = std::min(m_image.width(), int(std::ceil(exposed.right() / CellSize)));
+    int bottom = std::min(m_image.height(), int(std::ceil(exposed.bottom() / CellSize)));
+    if (left >= right || top >= bottom)
+        return;
+
+    QRect cells(QPoint(left, top), QPoint(right - 1, bottom - 1));
+    QRect target(cells.topLeft() * CellSize, cells.size() * CellSize);
+
+    if (level == 0)
+        drawLevel(painter, m_image, 0, cells);
+    else
+        drawLevel(painter, m_levels[level - 1].image, level, cells);
+
+    if (scale * CellSize < MinGridLineCellSize)
+        return;
+
+    painter->setPen(QPen(Qt::black, 0));
+    for (int x = left; x <= right; ++x)
+        painter->drawLine(x * CellSize, target.top(), x * CellSize, target.bottom() + 1);
+    for (int y = top; y <= bottom; ++y)
+        painter->drawLine(target.left(), y * CellSize, target.right() + 1, y * CellSize);
+}
+
+// Draws the given cells from an image holding one pixel per 2^shift x 2^shift
+// block.  Only the blocks needed are copied out, which keeps the format
+// conversion done by the paint engine proportional to the exposed area.
+void GridItem::drawLevel(QPainter *painter, const QImage& image, int shift, const QRect& cells) const
+{
+    const qreal side = 1 << shift;
+    QRect blocks(QPoint(cells.left() >> shift, cells.top() >> shift),
+                 QPoint(cells.right() >> shift, cells.bottom() >> shift));
+    QRectF source(QPointF(cells.topLeft()) / side - QPointF(blocks.topLeft()),
+                  QSizeF(cells.size()) / side);
+    QRect target(cells.topLeft() * CellSize, cells.size() * CellSize);
+
+    painter->drawImage(target, image.copy(blocks), source);
+}
+
+// Blits the renderer's newest frame for the visible part of the grid,
+// requesting a new one if the view moved or the grid changed.  A frame of a
+// previous view position is drawn scaled until the new one arrives.
+bool GridItem::drawRenderedFrame(QPainter *painter, QWidget *widget)
+{
+    const QTransform transform = painter->worldTransform();
+    QRectF visible = transform.inverted().mapRect(QRectF(widget->rect()))
+        & QRectF(QPointF(0, 0), QSizeF(m_image.size() * CellSize));
+    if (visible.isEmpty())
+        return true;
+
+    const qreal ratio = widget->devicePixelRatioF();
+    QRectF source(visible.topLeft() / CellSize, visible.size() / CellSize);
+    QRectF target = transform.mapRect(visible);
+    QSize size = (target.size() * ratio).toSize();
+
+    if (size.isEmpty())
+        return true;
+    if (source != m_requestedSource || size != m_requestedSize || m_frameOutdated) {
+        m_requestedSource = source;
+        m_requestedSize = size;
+        m_frameOutdated = false;
+        m_renderer->requestFrame(m_grid->cells(), source, size);
+    }
+
+    const FrameRenderer::Frame *frame = m_renderer->latestFrame();
+    if (frame == nullptr)
+        return false;
+
+    QRectF frameRect(frame->source.topLeft() * CellSize, frame->source.size() * CellSize);
+    painter->save();
+    painter->setWorldTransform(QTransform());
+    painter->drawImage(transform.mapRect(frameRect), frame->image);
+    painter->restore();
+    return true;
+}
@@ -0,0 +1,97 @@
+#ifndef GRIDITEM_H_INCLUDED
+#define GRIDITEM_H_INCLUDED
+
+#include <QGraphicsObject>
+#include <QImage>
+#include <QVector>
+
+class FrameRenderer;
+class Grid;
+class QTimer;
+
+// Draws a whole grid from a one-bit-per-cell image, so the scene holds a
+// single item however large the grid gets.  Cell (x, y) covers the item
+// rectangle starting at (x, y) * CellSize.
+//
+// When a cell gets smaller than a device pixel the item draws one of its
+// mipmaps instead: level k shades every 2^k x 2^k block of cells by the
+// fraction of live cells in it.  The block counts are kept up to date on
+// every cell change, so no level is ever rebuilt during playback.
+//
+// Cell changes are not repainted one by one.  They are gathered into one
+// dirty rectangle per tile and flushed together once control returns to the
+// event loop, so a large change set costs a handful of update requests.
+//
+// While zoomed out far enough for the mipmaps to be used, frames are
+// rasterized from snapshots of the grid by a FrameRenderer thread instead.
+// Cell changes then only mark the image and mipmaps stale; they are rebuilt
+// from the grid once the view zooms back in.
+class GridItem : public QGraphicsObject
+{
+    Q_OBJECT
+public:
+    static constexpr int CellSize = 10;
+    // Grid lines are only drawn when a cell covers at least this many
+    // device pixels.
+    static constexpr qreal MinGridLineCellSize = 4;
+    // Mipmap levels kept besides the cell image; a level 7 block holds at
+    // most 16384 cells, which still fits the counters.
+    static constexpr int MaxMipLevels = 7;
+    // Side of the square tiles dirty cells are gathered in, in cells.
+    static constexpr int DirtyTileSize = 64;
+    // Past this many dirty tiles a flush repaints their bounding rectangle.
+    static constexpr int MaxDirtyRects = 64;
+
+    explicit GridItem(const Grid *grid, QGraphicsItem *parent = nullptr);
+
+    QSize gridSize() const { return m_image.size(); }
+    QRect cellRect(const QPoint& cell) const;
+
+    // Rebuilds the image from the states in the grid.
+    void reset();
+    // Changes the shown state of one cell without touching the grid.
+    void setCellState(const QPoint& cell, bool state);
+
+    virtual QRectF boundingRect() const override;
+    virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+                       QWidget *widget = nullptr) override;
+
+private slots:
+    void flushDirty();
+    void onFrameReady();
+
+private:
+    struct MipLevel
+    {
+        int shift;
+        QImage image;
+        QVector<quint16> counts;
+    };
+
+    void rebuildImage();
+    void resetMipLevels();
+    void updateBlock(MipLevel& level, const QPoint& block);
+    void drawLevel(QPainter *painter, const QImage& image, int shift, const QRect& cells) const;
+    void markDirty(const QPoint& cell);
+    void resetDirty();
+    QRect cellsRect(const QRect& cells) const;
+    bool drawRenderedFrame(QPainter *painter, QWidget *widget);
+
+    const Grid *m_grid;
+    QImage m_image;
+    QVector<MipLevel> m_levels;
+    QVector<QRect> m_dirtyTiles;
+    QVector<int> m_dirtyList;
+    QRect m_dirtyBounds;
+    QTimer *m_flushTimer;
+    FrameRenderer *m_renderer;
+    // Whether the renderer draws the item, whether the image and mipmaps
+    // lag behind the grid, and whether the last requested frame does.
+    bool m_rendering = false;
+    bool m_stale = false;
+    bool m_frameOutdated = false;
+    QRectF m_requestedSource;
+    QSize m_requestedSize;
+};
+
+#endif /* GRIDITEM_H_INCLUDED */
@@ -1,85 +1,62 @@
+#include <cmath>
 #include <QtGlobal>
 #include <QGraphicsView>
 #include "gridview.h"
+#include "griditem.h"
+
+static_assert(GridView::RectSize == GridItem::CellSize, "cell sizes must agree");
 
 GridView::GridView(Grid *grid, QGraphicsView *view, QObject *parent)
     : QObject(parent),
       m_grid(grid),
-      m_view(view)
+      m_view(view),
+      m_item(new GridItem(grid))
 {
-    connect(grid, SIGNAL(rowAdded()), this, SLOT(addRow()));
-    connect(grid, SIGNAL(rowRemoved()), this, SLOT(removeRow()));
-    connect(grid, SIGNAL(columnAdded()), this, SLOT(addColumn()));
-    connect(grid, SIGNAL(columnRemoved()), this, SLOT(removeColumn()));
+    connect(grid, SIGNAL(sizeChanged(QSize,QSize)), this, SLOT(resetItem()));
     connect(grid, SIGNAL(cellStateChanged(QPoint,bool)),
             this, SLOT(setVisibleCellState(QPoint,bool)));
+    connect(grid, SIGNAL(cellStatesChanged(QVector<QPoint>)),
+            this, SLOT(updateVisibleCellStates(QVector<QPoint>)));
 
     view->setScene(new QGraphicsScene(view));
-    drawInitialGrid();
+    view->scene()->addItem(m_item);
+    resetItem();
 }
 
-void GridView::drawInitialGrid()
+void GridView::resetItem()
 {
-    for (int i = 0; i < m_grid->cols(); ++i)
-        for (int j = 0; j < m_grid->rows(); ++j)
-            addCell({i, j});
+    m_item->reset();
 }
 
-void GridView::addRow()
+QPoint GridView::unboundedCellAtPos(const QPoint &point)
 {
-    for (int i = 0; i < m_grid->cols(); ++i)
-        addCell({i, m_grid->rows() - 1});
+    QPointF pos = m_item->mapFromScene(m_view->mapToScene(point));
+    return QPoint(int(std::floor(pos.x() / RectSize)), int(std::floor(pos.y() / RectSize)));
 }
 
-void GridView::removeRow()
+boost::optional<QPoint> GridView::cellAtPos(const QPoint &point)
 {
-    for (int i = 0; i < m_grid->cols(); ++i)
-        removeCell({i, m_grid->rows()});
-}
+    QPoint ret = unboundedCellAtPos(point);
 
-void GridView::addColumn()
-{
-    for (int i = 0; i < m_grid->rows(); ++i)
-        addCell({m_grid->cols() - 1, i});
+    if (ret.x() < 0 || ret.y() < 0 || ret.x() >= m_grid->cols() || ret.y() >= m_grid->rows())
+        return boost::none;
+    return ret;
 }
 
-void GridView::removeColumn()
+QPoint GridView::nearestCellAtPos(const QPoint &point)
 {
-    for (int i = 0; i < m_grid->rows(); ++i)
-        removeCell({m_grid->cols(), i});
-}
+    QPoint ret = unboundedCellAtPos(point);
 
-void GridView::addCell(const QPoint& cell)
-{
-    auto *item = m_view->scene()->addRect(0, 0, RectSize, RectSize);
-    item->setPos(cell * RectSize);
-    m_grid->setCellDataAt(cell, QVariant::fromValue(item));
+    return {qBound(0, ret.x(), m_grid->cols() - 1), qBound(0, ret.y(), m_grid->rows() - 1)};
 }
 
-void GridView::removeCell(const QPoint& cell)
-{
-    auto *item = qvariant_cast<QGraphicsRectItem*>(m_grid->dataAt(cell));
-    delete item;
-}
-
-boost::optional<QPoint> GridView::cellAtPos(const QPoint &point)
+void GridView::setVisibleCellState(const QPoint& cell, bool state)
 {
-    if (QGraphicsItem *atPos = m_view->itemAt(point)) {
-        QPoint ret = atPos->scenePos().toPoint();
-
-        ret /= RectSize;
-        return ret;
-    }
-
-    return boost::none;
+    m_item->setCellState(cell, state);
 }
 
-void GridView::setVisibleCellState(const QPoint& cell, bool state)
+void GridView::updateVisibleCellStates(const QVector<QPoint>& cells)
 {
-    QGraphicsRectItem *item = qvariant_cast<QGraphicsRectItem*>(m_grid->dataAt(cell));
-
-    if (state)
-        item->setBrush(Qt::black);
-    else
-        item->setBrush(Qt::white);
+    for (const QPoint& cell : cells)
+        m_item->setCellState(cell, m_grid->stateAt(cell));
 }
@@ -2,13 +2,12 @@
 #define GRIDVIEW_H_INCLUDED
 
 #include <QObject>
-#include <QGraphicsRectItem>
 #include <QPointer>
 #include <QGraphicsView>
 #include <boost/optional.hpp>
 #include "grid.h"
 
-Q_DECLARE_METATYPE(QGraphicsRectItem*)
+class GridItem;
 
 class GridView : public QObject
 {
@@ -17,28 +16,28 @@ public:
     static constexpr int RectSize = 10;
     GridView(Grid *grid, QGraphicsView *view, QObject *parent = nullptr);
 
-private:
-    void drawInitialGrid();
-
-public:
     Grid *grid() { return m_grid.data(); }
     QGraphicsView *view() { return m_view.data(); }
+    GridItem *item() { return m_item; }
+    // The cell under a viewport position, if any, and the valid cell
+    // closest to it.  Both are plain arithmetic on the view transform.
     boost::optional<QPoint> cellAtPos(const QPoint &point);
+    QPoint nearestCellAtPos(const QPoint &point);
 
 private slots:
-    void addRow();
-    void addColumn();
-    void removeColumn();
-    void removeRow();
-    void addCell(const QPoint& cell);
-    void removeCell(const QPoint& cell);
+    void resetItem();
+
+private:
+    QPoint unboundedCellAtPos(const QPoint &point);
 
 public slots:
     void setVisibleCellState(const QPoint& cell, bool state);
+    void updateVisibleCellStates(const QVector<QPoint>& cells);
 
 private:
     QPointer<Grid> m_grid;
     QPointer<QGraphicsView> m_view;
+    GridItem *m_item;
 };
 
 #endif /* GRIDVIEW_H_INCLUDED */
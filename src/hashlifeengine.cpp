@@ -0,0 +1,421 @@
+#include <algorithm>
+#include <QDebug>
+#include <QtAlgorithms>
+#include "hashlifeengine.h"
+#include "grid.h"
+
+struct HashlifeEngine::Node
+{
+    Node *nw, *ne, *sw, *se;
+    // The centre half of this node, 2^min(step, level - 2) generations later.
+    Node *result;
+    // Next node in the same hash bucket.
+    Node *next;
+    quint64 population;
+    int level;
+    bool marked;
+};
+
+namespace {
+    // Steps above this size are split up, keeping the coordinates of the
+    // tree well within 64 bits.
+    constexpr int MaxStep = 56;
+    constexpr int MinBuckets = 1 << 10;
+
+    inline uint hashChildren(const void *nw, const void *ne, const void *sw, const void *se)
+    {
+        constexpr quint64 Multiplier = Q_UINT64_C(0x9E3779B97F4A7C15);
+        quint64 hash = reinterpret_cast<quintptr>(nw);
+
+        hash = hash * Multiplier + reinterpret_cast<quintptr>(ne);
+        hash = hash * Multiplier + reinterpret_cast<quintptr>(sw);
+        hash = hash * Multiplier + reinterpret_cast<quintptr>(se);
+        return uint(hash ^ (hash >> 32));
+    }
+
+    inline qint64 sideLength(int level)
+    {
+        return qint64(1) << level;
+    }
+}
+
+HashlifeEngine::HashlifeEngine(qint64 memoryLimit)
+    : m_memoryLimit(memoryLimit),
+      m_leaves(new Node[2])
+{
+    for (int i = 0; i < 2; ++i)
+        m_leaves[i] = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, quint64(i), 0, true};
+    m_buckets.fill(nullptr, MinBuckets);
+}
+
+HashlifeEngine::~HashlifeEngine()
+{
+    for (Node *node : m_buckets)
+        while (node) {
+            Node *next = node->next;
+            delete node;
+            node = next;
+        }
+
+    delete[] m_leaves;
+}
+
+qint64 HashlifeEngine::memoryUsage() const
+{
+    return qint64(m_nodeCount) * sizeof(Node) + qint64(m_buckets.size()) * sizeof(Node*);
+}
+
+void HashlifeEngine::nextGeneration(const Grid& grid, ChangeSet& changes)
+{
+    advance(grid, 1, changes);
+}
+
+ChangeSet HashlifeEngine::advance(const Grid& grid, quint64 generations)
+{
+    ChangeSet ret;
+    advance(grid, generations, ret);
+    return ret;
+}
+
+void HashlifeEngine::advance(const Grid& grid, quint64 generations, ChangeSet& changes)
+{
+    changes.clear();
+
+    if (!m_root || grid.cells().size() != m_gridSize) {
+        m_gridSize = grid.cells().size();
+
+        int level = 3;
+        while (sideLength(level - 1) < std::max(m_gridSize.width(), m_gridSize.height()))
+            ++level;
+        m_root = build(grid.cells(), level, -sideLength(level - 1), -sideLength(level - 1));
+    }
+
+    Node *before = m_root;
+    QThread *thread = QThread::currentThread();
+    quint64 remaining = generations;
+
+    while (remaining && m_root->population && !thread->isInterruptionRequested()) {
+        if (memoryUsage() > m_memoryLimit)
+            collectGarbage(before);
+
+        // Cells outside the grid cannot come alive within as many
+        // generations as they are away from the pattern, so a step that long
+        // is exact; next to the border this falls back to single steps.
+        int log2Generations = std::min<int>(63 - qCountLeadingZeroBits(remaining), MaxStep);
+        qint64 corner = -sideLength(m_root->level - 1);
+        qint64 reach = margin(m_root, corner, corner, sideLength(log2Generations)) + 1;
+        while (log2Generations > 0 && sideLength(log2Generations) > reach)
+            --log2Generations;
+
+        step(log2Generations);
+        m_root = clip(m_root, -sideLength(m_root->level - 1), -sideLength(m_root->level - 1));
+        remaining -= quint64(1) << log2Generations;
+    }
+
+    while (before->level < m_root->level)
+        before = expand(before);
+    while (m_root->level < before->level)
+        m_root = expand(m_root);
+
+    qint64 corner = -sideLength(m_root->level - 1);
+    diff(before, m_root, corner, corner, changes);
+
+    if (memoryUsage() > m_memoryLimit)
+        collectGarbage(nullptr);
+}
+
+void HashlifeEngine::step(int log2Generations)
+{
+    if (log2Generations != m_step) {
+        clearResults();
+        m_step = log2Generations;
+    }
+
+    // The pattern has to sit inside the centre quarter of the root, so that
+    // it cannot grow out of the centre half the successor covers.
+    auto isCentred = [] (Node *node) {
+        return node->nw->se->se->population + node->ne->sw->sw->population
+            + node->sw->ne->ne->population + node->se->nw->nw->population
+            == node->population;
+    };
+
+    while (m_root->level < log2Generations + 3 || !isCentred(m_root))
+        m_root = expand(m_root);
+
+    m_root = successor(m_root);
+}
+
+HashlifeEngine::Node *HashlifeEngine::leaf(bool alive)
+{
+    return &m_leaves[alive];
+}
+
+HashlifeEngine::Node *HashlifeEngine::join(Node *nw, Node *ne, Node *sw, Node *se)
+{
+    uint hash = hashChildren(nw, ne, sw, se);
+    Node *&bucket = m_buckets[hash & (m_buckets.size() - 1)];
+
+    for (Node *node = bucket; node; node = node->next)
+        if (node->nw == nw && node->ne == ne && node->sw == sw && node->se == se)
+            return node;
+
+    Node *node = new Node{nw, ne, sw, se, nullptr, bucket,
+                          nw->population + ne->population + sw->population + se->population,
+                          nw->level + 1, false};
+    bucket = node;
+
+    if (++m_nodeCount > m_buckets.size())
+        rehash(m_buckets.size() * 2);
+
+    return node;
+}
+
+HashlifeEngine::Node *HashlifeEngine::empty(int level)
+{
+    if (level == 0)
+        return leaf(false);
+
+    if (m_empty.size() <= level)
+        m_empty.resize(level + 1);
+
+    if (!m_empty[level]) {
+        Node *child = empty(level - 1);
+        m_empty[level] = join(child, child, child, child);
+    }
+
+    return m_empty[level];
+}
+
+HashlifeEngine::Node *HashlifeEngine::centre(Node *node)
+{
+    return join(node->nw->se, node->ne->sw, node->sw->ne, node->se->nw);
+}
+
+HashlifeEngine::Node *HashlifeEngine::horizontalCentre(Node *west, Node *east)
+{
+    return join(west->ne, east->nw, west->se, east->sw);
+}
+
+HashlifeEngine::Node *HashlifeEngine::verticalCentre(Node *north, Node *south)
+{
+    return join(north->sw, north->se, south->nw, south->ne);
+}
+
+HashlifeEngine::Node *HashlifeEngine::expand(Node *node)
+{
+    Node *border = empty(node->level - 1);
+
+    return join(join(border, border, border, node->nw),
+                join(border, border, node->ne, border),
+                join(border, node->sw, border, border),
+                join(node->se, border, border, border));
+}
+
+HashlifeEngine::Node *HashlifeEngine::successor(Node *node)
+{
+    if (node->population == 0)
+        return empty(node->level - 1);
+    if (node->result)
+        return node->result;
+    if (node->level == 2)
+        return node->result = baseCase(node);
+
+    Node *n00 = node->nw, *n02 = node->ne, *n20 = node->sw, *n22 = node->se;
+    Node *n01 = horizontalCentre(n00, n02), *n21 = horizontalCentre(n20, n22);
+    Node *n10 = verticalCentre(n00, n20), *n12 = verticalCentre(n02, n22);
+    Node *n11 = centre(node);
+
+    // At full speed both halves of the step advance the pattern, otherwise
+    // the first half only takes the centres.
+    auto firstHalf = [this, node] (Node *part) {
+        return m_step >= node->level - 2 ? successor(part) : centre(part);
+    };
+
+    Node *r00 = firstHalf(n00), *r01 = firstHalf(n01), *r02 = firstHalf(n02),
+         *r10 = firstHalf(n10), *r11 = firstHalf(n11), *r12 = firstHalf(n12),
+         *r20 = firstHalf(n20), *r21 = firstHalf(n21), *r22 = firstHalf(n22);
+
+    return node->result = join(successor(join(r00, r01, r10, r11)),
+                               successor(join(r01, r02, r11, r12)),
+                               successor(join(r10, r11, r20, r21)),
+                               successor(join(r11, r12, r21, r22)));
+}
+
+HashlifeEngine::Node *HashlifeEngine::baseCase(Node *node)
+{
+    // Unpack the 4x4 block into a bitmap, bit y * 4 + x for cell (x, y).
+    uint bits = 0;
+    Node *quadrants[] = {node->nw, node->ne, node->sw, node->se};
+    for (int q = 0; q < 4; ++q) {
+        Node *cells[] = {quadrants[q]->nw, quadrants[q]->ne, quadrants[q]->sw, quadrants[q]->se};
+        for (int c = 0; c < 4; ++c) {
+            int x = (q % 2) * 2 + c % 2, y = (q / 2) * 2 + c / 2;
+            if (cells[c]->population)
+                bits |= 1u << (y * 4 + x);
+        }
+    }
+
+    auto nextState = [bits] (int x, int y) {
+        int count = 0;
+        for (int dy = -1; dy <= 1; ++dy)
+            for (int dx = -1; dx <= 1; ++dx)
+                if ((dx || dy) && bits >> ((y + dy) * 4 + x + dx) & 1)
+                    ++count;
+        return count == 3 || (count == 2 && (bits >> (y * 4 + x) & 1));
+    };
+
+    return join(leaf(nextState(1, 1)), leaf(nextState(2, 1)),
+                leaf(nextState(1, 2)), leaf(nextState(2, 2)));
+}
+
+HashlifeEngine::Node *HashlifeEngine::build(const CellBitSet& cells, int level, qint64 x, qint64 y)
+{
+    const qint64 size = sideLength(level);
+
+    if (x >= cells.cols() || y >= cells.rows() || x + size <= 0 || y + size <= 0)
+        return empty(level);
+    if (level == 0)
+        return leaf(cells.test({static_cast<int>(x), static_cast<int>(y)}));
+
+    // Blocks one word wide can be checked for emptiness at once.
+    if (size == CellBitSet::WordBits && x >= 0) {
+        bool isEmpty = true;
+        for (qint64 row = std::max(y, qint64(0)); row < std::min(y + size, qint64(cells.rows())); ++row)
+            if (cells.row(int(row))[x / CellBitSet::WordBits])
+                isEmpty = false;
+        if (isEmpty)
+            return empty(level);
+    }
+
+    const qint64 half = size / 2;
+    return join(build(cells, level - 1, x, y), build(cells, level - 1, x + half, y),
+                build(cells, level - 1, x, y + half), build(cells, level - 1, x + half, y + half));
+}
+
+HashlifeEngine::Node *HashlifeEngine::clip(Node *node, qint64 x, qint64 y)
+{
+    const qint64 size = sideLength(node->level);
+
+    if (node->population == 0)
+        return node;
+    if (x >= 0 && y >= 0 && x + size <= m_gridSize.width() && y + size <= m_gridSize.height())
+        return node;
+    if (x >= m_gridSize.width() || y >= m_gridSize.height() || x + size <= 0 || y + size <= 0)
+        return empty(node->level);
+
+    const qint64 half = size / 2;
+    return join(clip(node->nw, x, y), clip(node->ne, x + half, y),
+                clip(node->sw, x, y + half), clip(node->se, x + half, y + half));
+}
+
+qint64 HashlifeEngine::margin(Node *node, qint64 x, qint64 y, qint64 smallest)
+{
+    const qint64 size = sideLength(node->level);
+    qint64 nearest = std::min({x, y, m_gridSize.width() - x - size, m_gridSize.height() - y - size});
+
+    if (node->population == 0 || nearest >= smallest)
+        return smallest;
+    if (node->level == 0)
+        return nearest;
+
+    const qint64 half = size / 2;
+    smallest = margin(node->nw, x, y, smallest);
+    smallest = margin(node->ne, x + half, y, smallest);
+    smallest = margin(node->sw, x, y + half, smallest);
+    return margin(node->se, x + half, y + half, smallest);
+}
+
+void HashlifeEngine::diff(Node *before, Node *after, qint64 x, qint64 y, ChangeSet& changes)
+{
+    if (before == after)
+        return;
+
+    if (before->level == 0) {
+        QPoint cell(static_cast<int>(x), static_cast<int>(y));
+        if (before->population)
+            changes.died += cell;
+        else
+            changes.spawned += cell;
+        return;
+    }
+
+    const qint64 half = sideLength(before->level - 1);
+    diff(before->nw, after->nw, x, y, changes);
+    diff(before->ne, after->ne, x + half, y, changes);
+    diff(before->sw, after->sw, x, y + half, changes);
+    diff(before->se, after->se, x + half, y + half, changes);
+}
+
+void HashlifeEngine::rehash(int buckets)
+{
+    QVector<Node*> old(buckets, nullptr);
+    old.swap(m_buckets);
+
+    for (Node *node : old)
+        while (node) {
+            Node *next = node->next;
+            Node *&bucket = m_buckets[hashChildren(node->nw, node->ne, node->sw, node->se)
+                                      & (buckets - 1)];
+            node->next = bucket;
+            bucket = node;
+            node = next;
+        }
+}
+
+void HashlifeEngine::collectGarbage(Node *extraRoot)
+{
+    int before = m_nodeCount;
+
+    mark(m_root);
+    mark(extraRoot);
+    for (Node *node : m_empty)
+        mark(node);
+
+    // Memoized results may point at nodes about to be freed.
+    for (Node *node : m_buckets)
+        for (; node; node = node->next)
+            if (node->marked && node->result && !node->result->marked)
+                node->result = nullptr;
+
+    for (Node *&bucket : m_buckets) {
+        Node **link = &bucket;
+        while (Node *node = *link) {
+            if (node->marked) {
+                node->marked = false;
+                link = &node->next;
+            }
+            else {
+                *link = node->next;
+                delete node;
+                --m_nodeCount;
+            }
+        }
+    }
+
+    int buckets = m_buckets.size();
+    while (buckets > MinBuckets && m_nodeCount < buckets / 4)
+        buckets /= 2;
+    if (buckets != m_buckets.size())
+        rehash(buckets);
+
+    qDebug() << "HashlifeEngine::collectGarbage: nodes" << before << "->" << m_nodeCount;
+}
+
+void HashlifeEngine::mark(Node *node)
+{
+    if (!node || node->marked)
+        return;
+
+    node->marked = true;
+    mark(node->nw);
+    mark(node->ne);
+    mark(node->sw);
+    mark(node->se);
+}
+
+void HashlifeEngine::clearResults()
+{
+    for (Node *node : m_buckets)
+        for (; node; node = node->next)
+            node->result = nullptr;
+}
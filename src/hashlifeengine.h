@@ -0,0 +1,71 @@
+#ifndef HASHLIFEENGINE_H_INCLUDED
+#define HASHLIFEENGINE_H_INCLUDED
+
+#include <QSize>
+#include <QVector>
+#include "engine.h"
+
+class CellBitSet;
+
+// Gosper's Hashlife: the grid is stored as a quadtree of hash-consed nodes,
+// and the future of every node is memoized, which lets advance() skip over
+// large powers of two generations at once.
+//
+// The tree describes the unbounded plane.  To honour the grid borders, cells
+// outside the grid are cleared after every step.  A jump is split into powers
+// of two no longer than the distance between the pattern and the border, so
+// it gives the same result as stepping one generation at a time.
+//
+// The node cache is garbage collected between steps whenever it grows over
+// the memory limit; nodes reachable from the current pattern are kept.
+class HashlifeEngine : public Engine
+{
+public:
+    HashlifeEngine(qint64 memoryLimit = qint64(512) << 20);
+    virtual ~HashlifeEngine();
+
+    virtual QString name() const override { return describe(Type::Hashlife); }
+    virtual void nextGeneration(const Grid& grid, ChangeSet& changes) override;
+    virtual ChangeSet advance(const Grid& grid, quint64 generations) override;
+
+    qint64 memoryUsage() const;
+
+private:
+    struct Node;
+
+    Node *leaf(bool alive);
+    Node *join(Node *nw, Node *ne, Node *sw, Node *se);
+    Node *empty(int level);
+    Node *centre(Node *node);
+    Node *horizontalCentre(Node *west, Node *east);
+    Node *verticalCentre(Node *north, Node *south);
+    Node *expand(Node *node);
+    Node *successor(Node *node);
+    Node *baseCase(Node *node);
+
+    void advance(const Grid& grid, quint64 generations, ChangeSet& changes);
+    Node *build(const CellBitSet& cells, int level, qint64 x, qint64 y);
+    Node *clip(Node *node, qint64 x, qint64 y);
+    // Fewest empty cells between a live cell of `node' and an edge of the
+    // grid, or `smallest' if that is fewer.
+    qint64 margin(Node *node, qint64 x, qint64 y, qint64 smallest);
+    void diff(Node *before, Node *after, qint64 x, qint64 y, ChangeSet& changes);
+    void step(int log2Generations);
+
+    void rehash(int buckets);
+    void collectGarbage(Node *extraRoot);
+    void mark(Node *node);
+    void clearResults();
+
+    qint64 m_memoryLimit;
+    QSize m_gridSize;
+    Node *m_root = nullptr;
+    int m_step = -1;
+
+    Node *m_leaves;
+    QVector<Node*> m_buckets;
+    QVector<Node*> m_empty;
+    int m_nodeCount = 0;
+};
+
+#endif /* HASHLIFEENGINE_H_INCLUDED */
@@ -1,8 +1,201 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QThread>
+#include <QTextStream>
+#include "benchmark.h"
+#include "exporter.h"
 #include "mainwindow.h"
 
+namespace {
+    bool hasOption(int argc, char **argv, const char *option)
+    {
+        const int length = qstrlen(option);
+        for (int i = 1; i < argc; ++i)
+            if (!qstrncmp(argv[i], option, length)
+                && (argv[i][length] == '\0' || argv[i][length] == '='))
+                return true;
+        return false;
+    }
+
+    bool parseEngine(const QString& name, Engine::Type *type)
+    {
+        for (Engine::Type candidate : Engine::types())
+            if (Engine::typeName(candidate).compare(name, Qt::CaseInsensitive) == 0) {
+                *type = candidate;
+                return true;
+            }
+        return false;
+    }
+
+    bool parseSize(const QString& value, QSize *size)
+    {
+        QStringList parts = value.split('x');
+        if (parts.size() != 2)
+            return false;
+
+        bool widthOk, heightOk;
+        *size = {parts[0].toInt(&widthOk), parts[1].toInt(&heightOk)};
+        return widthOk && heightOk;
+    }
+
+    int runBenchmark(const QCoreApplication& app)
+    {
+        QCommandLineParser parser;
+        QCommandLineOption benchmarkOption("benchmark", "Step a random soup and report the speed.");
+        QCommandLineOption engineOption("engine", "Simulation engine.", "name", "packed");
+        QCommandLineOption sizeOption("size", "Grid size.", "WxH", "2048x2048");
+        QCommandLineOption generationsOption("generations", "Generations to step.", "n", "1000");
+        QCommandLineOption densityOption("density", "Initial density of live cells.", "d", "0.5");
+        QCommandLineOption seedOption("seed", "Random seed.", "n", "1");
+        QCommandLineOption threadsOption("threads", "Stepping threads.", "n",
+                                         QString::number(QThread::idealThreadCount()));
+        QCommandLineOption memoryOption("memory-limit", "Hashlife node cache limit in MiB.", "n",
+                                        QString::number(EngineOptions().hashlifeMemoryLimit));
+        QCommandLineOption jumpOption("jump", "Advance over all generations at once.");
+        QCommandLineOption ioOption("io", "Also time saving and loading the final grid.");
+        QCommandLineOption checkOption("check", "Also check the result against packed stepping.");
+        QCommandLineOption compareOption("compare-engines",
+                                         "Check that all bounded engines agree, without timing.");
+
+        parser.addHelpOption();
+        parser.addOptions({benchmarkOption, engineOption, sizeOption,
+                           generationsOption, densityOption, seedOption, threadsOption,
+                           memoryOption, jumpOption, ioOption, checkOption, compareOption});
+        parser.process(app);
+
+        Benchmark benchmark;
+        bool ok = parseEngine(parser.value(engineOption), &benchmark.engineType)
+            && parseSize(parser.value(sizeOption), &benchmark.size);
+
+        if (ok)
+            benchmark.generations = parser.value(generationsOption).toInt(&ok);
+        if (ok)
+            benchmark.density = parser.value(densityOption).toDouble(&ok);
+        if (ok)
+            benchmark.seed = parser.value(seedOption).toUInt(&ok);
+        if (ok)
+            benchmark.engineOptions.threadCount = parser.value(threadsOption).toInt(&ok);
+        if (ok)
+            benchmark.engineOptions.hashlifeMemoryLimit = parser.value(memoryOption).toInt(&ok);
+        benchmark.jump = parser.isSet(jumpOption);
+        benchmark.io = parser.isSet(ioOption);
+        benchmark.check = parser.isSet(checkOption);
+        benchmark.compareEngines = parser.isSet(compareOption);
+
+        if (!ok || benchmark.size.isEmpty() || benchmark.engineOptions.threadCount < 1
+            || benchmark.engineOptions.hashlifeMemoryLimit < 1) {
+            QTextStream(stderr) << "Invalid benchmark options.\n";
+            return 1;
+        }
+
+        return benchmark.run();
+    }
+
+    int runExport(const QCoreApplication& app)
+    {
+        QCommandLineParser parser;
+        QCommandLineOption exportOption("export",
+                                        "Step a pattern and write its generations as images.",
+                                        "file");
+        QCommandLineOption patternOption("pattern",
+                                         "Pattern to start from; a random soup if not given.",
+                                         "file");
+        QCommandLineOption formatOption("format", "apng, or png for one numbered file per frame.",
+                                        "name", "apng");
+        QCommandLineOption engineOption("engine", "Simulation engine.", "name", "packed");
+        QCommandLineOption sizeOption("size", "Grid size; a pattern is centred in it.", "WxH",
+                                      "512x512");
+        QCommandLineOption densityOption("density", "Initial density of live cells.", "d", "0.5");
+        QCommandLineOption seedOption("seed", "Random seed.", "n", "1");
+        QCommandLineOption generationsOption("generations", "Generations to step.", "n", "100");
+        QCommandLineOption everyOption("every", "Write every nth generation.", "n", "1");
+        QCommandLineOption scaleOption("scale", "Image pixels per cell.", "s", "1");
+        QCommandLineOption regionOption("region", "Cells shown; the whole grid by default.",
+                                        "WxH+X+Y");
+        QCommandLineOption delayOption("delay", "Milliseconds per animation frame.", "ms", "100");
+        QCommandLineOption threadsOption("threads", "Stepping threads.", "n",
+                                         QString::number(QThread::idealThreadCount()));
+        QCommandLineOption memoryOption("memory-limit", "Hashlife node cache limit in MiB.", "n",
+                                        QString::number(EngineOptions().hashlifeMemoryLimit));
+        QCommandLineOption encodersOption("encoders", "Frame encoding threads.", "n",
+                                          QString::number(QThread::idealThreadCount()));
+        QCommandLineOption pendingOption("max-pending",
+                                         "Frames in flight at most; 0 for twice the encoders.",
+                                         "n", "0");
+
+        parser.addHelpOption();
+        parser.addOptions({exportOption, patternOption, formatOption, engineOption, sizeOption,
+                           densityOption, seedOption, generationsOption, everyOption, scaleOption,
+                           regionOption, delayOption, threadsOption, memoryOption, encodersOption,
+                           pendingOption});
+        parser.process(app);
+
+        Exporter exporter;
+        exporter.output = parser.value(exportOption);
+        exporter.pattern = parser.value(patternOption);
+        bool ok = parseEngine(parser.value(engineOption), &exporter.engineType)
+            && parseSize(parser.value(sizeOption), &exporter.size);
+
+        if (parser.value(formatOption) == "png")
+            exporter.format = Exporter::Format::PngSequence;
+        else if (parser.value(formatOption) != "apng")
+            ok = false;
+
+        if (ok && parser.isSet(regionOption)) {
+            QStringList parts = parser.value(regionOption).split('+');
+            QSize size;
+            bool xOk = false, yOk = false;
+            if (parts.size() == 3 && parseSize(parts[0], &size))
+                exporter.region = QRect(parts[1].toInt(&xOk), parts[2].toInt(&yOk),
+                                        size.width(), size.height());
+            ok = xOk && yOk && !exporter.region.isEmpty();
+        }
+
+        if (ok)
+            exporter.density = parser.value(densityOption).toDouble(&ok);
+        if (ok)
+            exporter.seed = parser.value(seedOption).toUInt(&ok);
+        if (ok)
+            exporter.generations = parser.value(generationsOption).toInt(&ok);
+        if (ok)
+            exporter.every = parser.value(everyOption).toInt(&ok);
+        if (ok)
+            exporter.scale = parser.value(scaleOption).toDouble(&ok);
+        if (ok)
+            exporter.frameDelay = parser.value(delayOption).toInt(&ok);
+        if (ok)
+            exporter.engineOptions.threadCount = parser.value(threadsOption).toInt(&ok);
+        if (ok)
+            exporter.engineOptions.hashlifeMemoryLimit = parser.value(memoryOption).toInt(&ok);
+        if (ok)
+            exporter.encoderCount = parser.value(encodersOption).toInt(&ok);
+        if (ok)
+            exporter.maxPendingFrames = parser.value(pendingOption).toInt(&ok);
+
+        if (!ok || exporter.output.isEmpty() || exporter.size.isEmpty() || exporter.generations < 0
+            || exporter.every < 1 || exporter.scale <= 0 || exporter.frameDelay < 0
+            || exporter.engineOptions.threadCount < 1
+            || exporter.engineOptions.hashlifeMemoryLimit < 1 || exporter.encoderCount < 1
+            || exporter.maxPendingFrames < 0) {
+            QTextStream(stderr) << "Invalid export options.\n";
+            return 1;
+        }
+
+        return exporter.run();
+    }
+}
+
 int main(int argc, char **argv)
 {
+    if (hasOption(argc, argv, "--benchmark")) {
+        QCoreApplication app(argc, argv);
+        return runBenchmark(app);
+    }
+    if (hasOption(argc, argv, "--export")) {
+        QCoreApplication app(argc, argv);
+        return runExport(app);
+    }
+
     QApplication app(argc, argv);
     MainWindow w;
 
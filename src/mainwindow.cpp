@@ -1,14 +1,19 @@
 #include "mainwindow.h"
+#include <QFileDialog>
 #include <QMouseEvent>
 #include <QMessageBox>
+#include <QSignalBlocker>
 #include <QInputDialog>
+#include <QLabel>
 #include <QStateMachine>
+#include <QTimer>
 #include "simulation.h"
 #include "gridview.h"
 #include "grid.h"
 #include "cellpainter.h"
 #include "templatemanager.h"
 #include "templatepainter.h"
+#include "replaydialog.h"
 
 class CurrentMousePositionIndicator : public QObject
 {
@@ -83,6 +88,24 @@ void MainWindow::saveGridAsTemplate()
                                   tr("Error ocurred when saving template file"));
 }
 
+void MainWindow::replayRecording()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Replay recording"), QString(),
+                                                    tr("Recordings (*.liferec)"));
+    if (fileName.isEmpty())
+        return;
+
+    ReplayDialog dialog(m_grid, this);
+    if (!dialog.openRecording(fileName)) {
+        QMessageBox::critical(this,
+                              tr("Error ocurred"),
+                              tr("Error ocurred when opening recording: %1")
+                              .arg(dialog.errorString()));
+        return;
+    }
+    dialog.exec();
+}
+
 void MainWindow::setupCellPainter()
 {
     if (m_currentTool) {
@@ -161,19 +184,36 @@ void MainWindow::onSimulationStarted()
     m_currentTool = nullptr;
     m_ui->spinBoxGridSizeX->setEnabled(false);
     m_ui->spinBoxGridSizeY->setEnabled(false);
+    m_ui->comboBoxEngine->setEnabled(false);
+    m_ui->spinBoxThreads->setEnabled(false);
+    m_ui->spinBoxHashlifeMemory->setEnabled(false);
+    m_ui->pushButtonJump->setEnabled(false);
+    m_ui->checkBoxRecord->setEnabled(false);
+    m_ui->pushButtonReplay->setEnabled(false);
     m_ui->pushButtonClearGrid->setEnabled(false);
     m_ui->pushButtonResetSimulation->setEnabled(true);
     m_ui->groupBoxTemplates->setEnabled(false);
+    updateQueueLabel();
+    m_queueLabel->setVisible(true);
+    m_queueLabelTimer->start();
 }
 
 void MainWindow::onSimulationEnded()
 {
     m_ui->spinBoxGridSizeX->setEnabled(true);
     m_ui->spinBoxGridSizeY->setEnabled(true);
+    m_ui->comboBoxEngine->setEnabled(true);
+    m_ui->spinBoxThreads->setEnabled(true);
+    m_ui->spinBoxHashlifeMemory->setEnabled(true);
+    m_ui->pushButtonJump->setEnabled(true);
+    m_ui->checkBoxRecord->setEnabled(true);
+    m_ui->pushButtonReplay->setEnabled(true);
     m_ui->pushButtonClearGrid->setEnabled(true);
     m_ui->pushButtonResetSimulation->setEnabled(m_simulation->preSimulationGrid() != nullptr);
     m_ui->groupBoxTemplates->setEnabled(true);
     m_ui->pushButtonStartSimulation->setChecked(false);
+    m_queueLabelTimer->stop();
+    m_queueLabel->setVisible(false);
     setupCellPainter();
 }
 
@@ -198,6 +238,39 @@ void MainWindow::setupChildObjects()
     new CurrentMousePositionIndicator(m_gridview, this);
 
     m_simulation->setDelay(m_ui->dialSimulationDelay->value());
+    m_simulation->setMaxSpeed(m_ui->checkBoxMaxSpeed->isChecked());
+
+    for (Engine::Type type : Engine::types())
+        m_ui->comboBoxEngine->addItem(Engine::typeName(type), static_cast<int>(type));
+    m_ui->comboBoxEngine->setCurrentIndex(
+        m_ui->comboBoxEngine->findData(static_cast<int>(m_simulation->engineType())));
+
+    m_ui->spinBoxThreads->setValue(m_simulation->threadCount());
+    m_ui->spinBoxHashlifeMemory->setValue(m_simulation->engineOptions().hashlifeMemoryLimit);
+
+    m_engineLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_engineLabel);
+    updateEngineLabel();
+
+    m_queueLabel = new QLabel(this);
+    m_queueLabel->setVisible(false);
+    statusBar()->addPermanentWidget(m_queueLabel);
+    m_queueLabelTimer = new QTimer(this);
+    m_queueLabelTimer->setInterval(500);
+}
+
+void MainWindow::updateEngineLabel()
+{
+    m_engineLabel->setText(tr("Engine: %1").arg(Engine::describe(m_simulation->engineType(),
+                                                                 m_simulation->engineOptions())));
+}
+
+void MainWindow::updateQueueLabel()
+{
+    m_queueLabel->setText(tr("Queue: %1, stalls: %2 / %3")
+                          .arg(m_simulation->queueDepth())
+                          .arg(m_simulation->producerStalls())
+                          .arg(m_simulation->consumerStalls()));
 }
 
 void MainWindow::setupSignalsAndSlots()
@@ -206,13 +279,15 @@ void MainWindow::setupSignalsAndSlots()
             m_grid, SLOT(setColCount(int)));
     connect(m_ui->spinBoxGridSizeY, SIGNAL(valueChanged(int)),
             m_grid, SLOT(setRowCount(int)));
-    connect(m_grid, &Grid::sizeChanged, [this] (const QSize& size) {
+    connect(m_grid, &Grid::sizeChanged, [this] (const QSize&, const QSize& size) {
             m_ui->spinBoxGridSizeX->setValue(size.width());
             m_ui->spinBoxGridSizeY->setValue(size.height());
             m_ui->canvas->setSceneRect(m_ui->canvas->scene()->itemsBoundingRect());
         });
 
     connect(m_ui->pushButtonClearGrid, SIGNAL(clicked()), m_grid, SLOT(clear()));
+    connect(m_ui->pushButtonClearGrid, SIGNAL(clicked()),
+            m_simulation, SLOT(discardOffGridCells()));
     connect(m_ui->pushButtonSaveGrid, SIGNAL(clicked()), this, SLOT(saveGridAsTemplate()));
 
     connect(m_ui->lineEditTemplateSearch, SIGNAL(textChanged(const QString&)),
@@ -223,6 +298,47 @@ void MainWindow::setupSignalsAndSlots()
 
     connect(m_ui->dialSimulationDelay, SIGNAL(valueChanged(int)),
             m_simulation, SLOT(setDelay(int)));
+    connect(m_ui->checkBoxMaxSpeed, SIGNAL(toggled(bool)),
+            m_simulation, SLOT(setMaxSpeed(bool)));
+
+    connect(m_ui->checkBoxRecord, &QCheckBox::toggled, [this] (bool checked) {
+            QString fileName;
+            if (checked) {
+                fileName = QFileDialog::getSaveFileName(this, tr("Record runs to"), QString(),
+                                                        tr("Recordings (*.liferec)"));
+                if (fileName.isEmpty()) {
+                    m_ui->checkBoxRecord->setChecked(false);
+                    return;
+                }
+            }
+            m_simulation->setRecordingFile(fileName);
+        });
+    connect(m_simulation, &Simulation::recordingEnded, [this] (const QString& fileName) {
+            const QSignalBlocker blocker(m_ui->checkBoxRecord);
+            m_ui->checkBoxRecord->setChecked(false);
+            statusBar()->showMessage(tr("Recording to %1 ended; check Record to record to "
+                                        "a new file.").arg(fileName));
+        });
+    connect(m_ui->pushButtonReplay, SIGNAL(clicked()), this, SLOT(replayRecording()));
+
+    connect(m_ui->comboBoxEngine,
+            static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this] (int index) {
+                QVariant type = m_ui->comboBoxEngine->itemData(index);
+                m_simulation->setEngineType(static_cast<Engine::Type>(type.toInt()));
+                updateEngineLabel();
+        });
+
+    connect(m_ui->spinBoxThreads,
+            static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            [this] (int threadCount) {
+                m_simulation->setThreadCount(threadCount);
+                updateEngineLabel();
+        });
+
+    connect(m_ui->spinBoxHashlifeMemory,
+            static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            m_simulation, &Simulation::setHashlifeMemoryLimit);
 
     connect(this, &MainWindow::templatePaintingDone, [this] {
             m_lastTemplatePainted = QModelIndex();
@@ -240,12 +356,18 @@ void MainWindow::setupSignalsAndSlots()
             m_ui->spinBoxZoomAmount->setValue(factor * 100);
         });
 
+    connect(m_queueLabelTimer, &QTimer::timeout, this, &MainWindow::updateQueueLabel);
+
     connect(this, SIGNAL(destroyed()), m_simulation, SLOT(stop()));
     connect(m_simulation, SIGNAL(started()), this, SLOT(onSimulationStarted()));
     connect(m_simulation, SIGNAL(ended()), this, SLOT(onSimulationEnded()));
 
     connect(m_ui->pushButtonStartSimulation, SIGNAL(clicked()), this, SLOT(controlSimulation()));
     connect(m_ui->pushButtonSimulationStep, SIGNAL(clicked()), this, SLOT(controlSimulation()));
+    connect(m_ui->pushButtonJump, &QPushButton::clicked, [this] {
+            m_ui->pushButtonStartSimulation->setChecked(false);
+            m_simulation->jump(m_ui->spinBoxJumpGenerations->value());
+        });
     connect(m_ui->pushButtonResetSimulation, &QPushButton::clicked, [this] {
             m_simulation->reset();
             m_ui->pushButtonResetSimulation->setEnabled(false);
@@ -11,6 +11,8 @@ class GridView;
 class Simulation;
 class TemplateManager;
 class GridMouseTool;
+class QLabel;
+class QTimer;
 
 class MainWindow : public QMainWindow
 {
@@ -30,6 +32,7 @@ private slots:
     void onSimulationEnded();
 
     void saveGridAsTemplate();
+    void replayRecording();
 
 signals:
     void templatePaintingDone();
@@ -38,6 +41,8 @@ private:
     void setupUI();
     void setupChildObjects();
     void setupSignalsAndSlots();
+    void updateEngineLabel();
+    void updateQueueLabel();
 
     QAbstractItemModel *templateListModel()
     {
@@ -52,6 +57,9 @@ private:
     QModelIndex m_lastTemplatePainted;
     TemplateManager *m_templateManager;
     QSortFilterProxyModel *m_sortedModel;
+    QLabel *m_engineLabel;
+    QLabel *m_queueLabel;
+    QTimer *m_queueLabelTimer;
 };
 
 #endif /* MAINWINDOW_H_INCLUDED */
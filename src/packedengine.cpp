@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <functional>
+#include <QAtomicInt>
+#include <QRunnable>
+#include "packedengine.h"
+#include "grid.h"
+
+namespace {
+    using Word = PackedEngine::Word;
+
+    // Bands are kept small enough that every thread gets several of them, so
+    // threads that finish early pick up the remaining ones.
+    constexpr int MinBandRows = 16;
+    constexpr int BandsPerThread = 4;
+
+    class BandStepper
+    {
+    public:
+        BandStepper(const PackedKernel& kernel, const CellBitSet& cells)
+            : m_kernel(kernel),
+              m_cells(cells)
+        {
+            for (auto& row : m_padded)
+                row.fill(0, cells.wordsPerRow() + 2);
+            m_next.fill(0, cells.wordsPerRow());
+        }
+
+        // Steps rows [begin, end) of the grid.
+        void step(int begin, int end, ChangeSet& changes)
+        {
+            const int words = m_cells.wordsPerRow();
+            const Word mask = m_cells.lastWordMask();
+
+            loadRow(begin - 1);
+            loadRow(begin);
+            for (int y = begin; y < end; ++y) {
+                loadRow(y + 1);
+
+                m_kernel.stepRow(paddedRow(y - 1), paddedRow(y), paddedRow(y + 1),
+                                 m_next.data(), words);
+                m_next[words - 1] &= mask;
+
+                changes.addRowDifference(m_cells.row(y), m_next.constData(), words, mask, y);
+            }
+        }
+
+    private:
+        // Rows y - 1, y and y + 1 are kept in a ring of three padded rows.
+        const Word *paddedRow(int y) const
+        {
+            return m_padded[(y + 1) % 3].constData() + 1;
+        }
+
+        void loadRow(int y)
+        {
+            Word *dest = m_padded[(y + 1) % 3].data() + 1;
+            if (y >= 0 && y < m_cells.rows()) {
+                std::copy_n(m_cells.row(y), m_cells.wordsPerRow(), dest);
+                dest[m_cells.wordsPerRow() - 1] &= m_cells.lastWordMask();
+            } else
+                std::fill_n(dest, m_cells.wordsPerRow(), 0);
+        }
+
+        const PackedKernel& m_kernel;
+        const CellBitSet& m_cells;
+        QVector<Word> m_padded[3];
+        QVector<Word> m_next;
+    };
+
+    class FunctionRunnable : public QRunnable
+    {
+    public:
+        FunctionRunnable(std::function<void()> function)
+            : m_function(std::move(function))
+        { }
+
+        virtual void run() override { m_function(); }
+
+    private:
+        std::function<void()> m_function;
+    };
+}
+
+PackedEngine::PackedEngine(int threadCount, const PackedKernel& kernel)
+    : m_kernel(kernel),
+      m_threadCount(std::max(1, threadCount))
+{
+    m_pool.setMaxThreadCount(m_threadCount - 1);
+}
+
+QString PackedEngine::describe(const PackedKernel& kernel, int threadCount)
+{
+    return QString("packed (%1, %2 threads)").arg(kernel.name()).arg(std::max(1, threadCount));
+}
+
+void PackedEngine::nextGeneration(const Grid& grid, ChangeSet& changes)
+{
+    const CellBitSet& cells = grid.cells();
+    const int rows = cells.rows();
+
+    changes.clear();
+    if (cells.wordsPerRow() == 0)
+        return;
+
+    const int bandRows = std::max(MinBandRows, rows / (m_threadCount * BandsPerThread));
+    const int bands = (rows + bandRows - 1) / bandRows;
+
+    m_bandChanges.resize(bands);
+    ChangeSet *bandChanges = m_bandChanges.data();
+    QAtomicInt nextBand(0);
+
+    auto work = [&] {
+        BandStepper stepper(m_kernel, cells);
+        int band;
+
+        while ((band = nextBand.fetchAndAddRelaxed(1)) < bands) {
+            bandChanges[band].clear();
+            stepper.step(band * bandRows, std::min(rows, (band + 1) * bandRows),
+                         bandChanges[band]);
+        }
+    };
+
+    // The calling thread takes part too.
+    int helpers = std::min(m_threadCount, bands) - 1;
+    for (int i = 0; i < helpers; ++i)
+        m_pool.start(new FunctionRunnable(work));
+    work();
+    m_pool.waitForDone();
+
+    int died = 0, spawned = 0;
+    for (const ChangeSet& band : m_bandChanges) {
+        died += band.died.size();
+        spawned += band.spawned.size();
+    }
+
+    changes.died.reserve(died);
+    changes.spawned.reserve(spawned);
+    for (const ChangeSet& band : m_bandChanges) {
+        changes.died += band.died;
+        changes.spawned += band.spawned;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef PACKEDENGINE_H_INCLUDED
+#define PACKEDENGINE_H_INCLUDED
+
+#include <QThread>
+#include <QThreadPool>
+#include <vector>
+#include "cellbitset.h"
+#include "engine.h"
+#include "packedkernel.h"
+
+// Steps the bit-packed rows of a grid, computing the next state of whole
+// words of cells at once with bitwise full adders (see PackedKernel).
+//
+// The grid is cut into bands of rows which are stepped in parallel.  Every
+// band reads the rows bordering it directly from the current generation,
+// which stays read-only for the whole step, and collects its own ChangeSet;
+// these are concatenated in band order at the end.
+class PackedEngine : public Engine
+{
+public:
+    using Word = CellBitSet::Word;
+
+    PackedEngine(int threadCount = QThread::idealThreadCount(),
+                 const PackedKernel& kernel = PackedKernel::active());
+
+    static QString describe(const PackedKernel& kernel, int threadCount);
+
+    virtual QString name() const override { return describe(m_kernel, m_threadCount); }
+    virtual void nextGeneration(const Grid& grid, ChangeSet& changes) override;
+
+private:
+    const PackedKernel& m_kernel;
+    int m_threadCount;
+    QThreadPool m_pool;
+    std::vector<ChangeSet> m_bandChanges;
+};
+
+#endif /* PACKEDENGINE_H_INCLUDED */
@@ -0,0 +1,155 @@
+#include <cstring>
+#include <vector>
+#include <QDebug>
+#include <QtGlobal>
+#include "packedkernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GAMEOFLIFE_X86_KERNELS
+#  ifndef __clang__
+// The vector helpers are always inlined, so their argument ABI never matters.
+#    pragma GCC diagnostic ignored "-Wpsabi"
+#  endif
+#endif
+
+namespace {
+    using Word = PackedKernel::Word;
+    constexpr int WordBits = CellBitSet::WordBits;
+
+    // The kernel is written once against a type V that is either a single
+    // Word or a GCC vector of Words; the bitwise operators and shifts work
+    // lane-wise on both.  Each vector kernel is compiled for its instruction
+    // set through a target attribute, so no special build flags are needed.
+
+    template <typename V>
+    Q_ALWAYS_INLINE V load(const Word *words)
+    {
+        V ret;
+        std::memcpy(&ret, words, sizeof ret);
+        return ret;
+    }
+
+    template <typename V>
+    Q_ALWAYS_INLINE void store(Word *words, V value)
+    {
+        std::memcpy(words, &value, sizeof value);
+    }
+
+    template <typename V>
+    Q_ALWAYS_INLINE void fullAdd(V a, V b, V c, V& sum, V& carry)
+    {
+        V t = a ^ b;
+        sum = t ^ c;
+        carry = (a & b) | (t & c);
+    }
+
+    // Applies B3/S23 to the cells in `mid', given the eight words holding
+    // the state of each of their neighbours.
+    template <typename V>
+    Q_ALWAYS_INLINE V lifeRule(V mid, V n0, V n1, V n2, V n3, V n4, V n5, V n6, V n7)
+    {
+        V s0, c0, s1, c1, ones, c3, t, c4;
+
+        fullAdd(n0, n1, n2, s0, c0);
+        fullAdd(n3, n4, n5, s1, c1);
+        V s2 = n6 ^ n7, c2 = n6 & n7;
+        fullAdd(s0, s1, s2, ones, c3);
+
+        fullAdd(c0, c1, c2, t, c4);
+        V twos = t ^ c3, fours = c4 | (t & c3);
+
+        return twos & ~fours & (ones | mid);
+    }
+
+    template <typename V>
+    Q_ALWAYS_INLINE V westOf(const Word *row, int i)
+    {
+        return (load<V>(row + i) << 1) | (load<V>(row + i - 1) >> (WordBits - 1));
+    }
+
+    template <typename V>
+    Q_ALWAYS_INLINE V eastOf(const Word *row, int i)
+    {
+        return (load<V>(row + i) >> 1) | (load<V>(row + i + 1) << (WordBits - 1));
+    }
+
+    // Steps whole groups of V starting at word i, returns the first word not
+    // stepped.
+    template <typename V>
+    Q_ALWAYS_INLINE int stepWords(const Word *up, const Word *mid, const Word *down,
+                                  Word *out, int i, int words)
+    {
+        constexpr int Lanes = sizeof(V) / sizeof(Word);
+
+        for (; i + Lanes <= words; i += Lanes)
+            store<V>(out + i, lifeRule<V>(load<V>(mid + i),
+                                          westOf<V>(up, i), load<V>(up + i), eastOf<V>(up, i),
+                                          westOf<V>(mid, i), eastOf<V>(mid, i),
+                                          westOf<V>(down, i), load<V>(down + i), eastOf<V>(down, i)));
+        return i;
+    }
+
+    void stepRowScalar(const Word *up, const Word *mid, const Word *down, Word *out, int words)
+    {
+        stepWords<Word>(up, mid, down, out, 0, words);
+    }
+
+#ifdef GAMEOFLIFE_X86_KERNELS
+    typedef Word Word2 __attribute__((vector_size(16)));
+    typedef Word Word4 __attribute__((vector_size(32)));
+    typedef Word Word8 __attribute__((vector_size(64)));
+
+    __attribute__((target("sse2")))
+    void stepRowSse2(const Word *up, const Word *mid, const Word *down, Word *out, int words)
+    {
+        int i = stepWords<Word2>(up, mid, down, out, 0, words);
+        stepWords<Word>(up, mid, down, out, i, words);
+    }
+
+    __attribute__((target("avx2")))
+    void stepRowAvx2(const Word *up, const Word *mid, const Word *down, Word *out, int words)
+    {
+        int i = stepWords<Word4>(up, mid, down, out, 0, words);
+        stepWords<Word>(up, mid, down, out, i, words);
+    }
+
+    __attribute__((target("avx512f")))
+    void stepRowAvx512(const Word *up, const Word *mid, const Word *down, Word *out, int words)
+    {
+        int i = stepWords<Word8>(up, mid, down, out, 0, words);
+        stepWords<Word>(up, mid, down, out, i, words);
+    }
+#endif
+}
+
+const PackedKernel& PackedKernel::active()
+{
+    static const PackedKernel kernel = select();
+    return kernel;
+}
+
+PackedKernel PackedKernel::select()
+{
+    // Ordered from the slowest to the fastest.
+    std::vector<PackedKernel> kernels{{"scalar", stepRowScalar}};
+
+#ifdef GAMEOFLIFE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        kernels.push_back({"sse2", stepRowSse2});
+    if (__builtin_cpu_supports("avx2"))
+        kernels.push_back({"avx2", stepRowAvx2});
+    if (__builtin_cpu_supports("avx512f"))
+        kernels.push_back({"avx512", stepRowAvx512});
+#endif
+
+    QString forced = QString::fromLocal8Bit(qgetenv("GAMEOFLIFE_KERNEL"));
+    if (!forced.isEmpty()) {
+        for (const PackedKernel& kernel : kernels)
+            if (kernel.name() == forced)
+                return kernel;
+        qWarning() << "PackedKernel::select: kernel not available:" << forced;
+    }
+
+    return kernels.back();
+}
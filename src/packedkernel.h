@@ -0,0 +1,41 @@
+#ifndef PACKEDKERNEL_H_INCLUDED
+#define PACKEDKERNEL_H_INCLUDED
+
+#include <QString>
+#include "cellbitset.h"
+
+// A row stepping routine for PackedEngine.  The fastest one the CPU supports
+// is picked on first use; set GAMEOFLIFE_KERNEL to a kernel name to force
+// another one.
+class PackedKernel
+{
+public:
+    using Word = CellBitSet::Word;
+    using StepRowFunction = void (*)(const Word *up, const Word *mid, const Word *down,
+                                     Word *out, int words);
+
+    static const PackedKernel& active();
+
+    QString name() const { return m_name; }
+
+    // Computes `words' words of the next generation of the row `mid'.  All
+    // three input rows must be padded with one word on each side, holding the
+    // cells just outside the row (zero at the grid border).
+    void stepRow(const Word *up, const Word *mid, const Word *down, Word *out, int words) const
+    {
+        m_stepRow(up, mid, down, out, words);
+    }
+
+private:
+    PackedKernel(const QString& name, StepRowFunction stepRow)
+        : m_name(name),
+          m_stepRow(stepRow)
+    { }
+
+    static PackedKernel select();
+
+    QString m_name;
+    StepRowFunction m_stepRow;
+};
+
+#endif /* PACKEDKERNEL_H_INCLUDED */
@@ -0,0 +1,51 @@
+#include <QFileInfo>
+#include "patternformat.h"
+#include "snapshot.h"
+
+PatternFormat patternFormatForFileName(const QString& fileName)
+{
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+
+    if (suffix == "rle")
+        return PatternFormat::Rle;
+    if (suffix == "lif" || suffix == "life")
+        return PatternFormat::Life106;
+    if (suffix == "cells")
+        return PatternFormat::Plaintext;
+    if (suffix == "snap")
+        return PatternFormat::Snapshot;
+    return PatternFormat::Native;
+}
+
+PatternFormat detectPatternFormat(const QByteArray& head)
+{
+    if (Snapshot::isSnapshot(head))
+        return PatternFormat::Snapshot;
+    if (head.startsWith("#Life 1.06"))
+        return PatternFormat::Life106;
+
+    // Comment lines come first in RLE files, the header line right after.
+    bool comments = false;
+    int i = 0;
+    while (i < head.size()) {
+        char c = head.at(i);
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            ++i;
+            continue;
+        }
+        if (c == '!' || c == '.' || c == 'O')
+            return PatternFormat::Plaintext;
+        if (c == 'x')
+            return PatternFormat::Rle;
+        if (c != '#')
+            return PatternFormat::Native;
+
+        comments = true;
+        int end = head.indexOf('\n', i);
+        if (end < 0)
+            break;
+        i = end + 1;
+    }
+
+    return comments ? PatternFormat::Rle : PatternFormat::Native;
+}
@@ -0,0 +1,26 @@
+#ifndef PATTERNFORMAT_H_INCLUDED
+#define PATTERNFORMAT_H_INCLUDED
+
+#include <QByteArray>
+#include <QString>
+
+// On-disk pattern formats.  Native is the "cols rows / count / x y" text
+// written by operator<<(QTextStream&, const Grid&); the others are the
+// formats used by public pattern collections.
+enum class PatternFormat
+{
+    Auto,       // detected from the contents when reading, Native when writing
+    Native,
+    Rle,        // run-length encoded, "x = m, y = n" header
+    Life106,    // "#Life 1.06" header, one "x y" line per live cell
+    Plaintext,  // .cells: '!' comments, rows of '.' and 'O'
+    Snapshot    // binary, memory-mappable, see Snapshot
+};
+
+// The format implied by a file name's suffix; Native if there is none known.
+PatternFormat patternFormatForFileName(const QString& fileName);
+
+// Guesses the format from the first bytes of a file.
+PatternFormat detectPatternFormat(const QByteArray& head);
+
+#endif /* PATTERNFORMAT_H_INCLUDED */
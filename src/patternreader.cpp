@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <QFileDevice>
+#include <QtDebug>
+#include "patternreader.h"
+#include "snapshot.h"
+
+namespace {
+    // Sets `count' cells of row `y' starting at column x.
+    void setRun(CellBitSet& cells, int y, int x, int count)
+    {
+        using Word = CellBitSet::Word;
+        Word *row = cells.row(y);
+
+        while (count > 0) {
+            int bit = x % CellBitSet::WordBits;
+            int n = std::min(count, CellBitSet::WordBits - bit);
+            Word mask = n == CellBitSet::WordBits ? ~Word(0) : ((Word(1) << n) - 1) << bit;
+            row[x / CellBitSet::WordBits] |= mask;
+            x += n;
+            count -= n;
+        }
+    }
+
+    bool isDigit(int c)
+    {
+        return c >= '0' && c <= '9';
+    }
+}
+
+PatternReader::PatternReader(QIODevice *device)
+    : m_device(device)
+{ }
+
+PatternReader::~PatternReader()
+{
+    if (m_map)
+        m_mappedFile->unmap(m_map);
+}
+
+bool PatternReader::read(CellBitSet& cells, PatternFormat format)
+{
+    m_error.clear();
+
+    if (format == PatternFormat::Auto)
+        format = detectPatternFormat(m_device->peek(DetectSize));
+    if (format == PatternFormat::Snapshot)
+        return Snapshot::read(m_device, cells, nullptr, &m_error);
+
+    qint64 start = m_device->pos();
+    map();
+
+    bool ok = false;
+    switch (format) {
+    case PatternFormat::Auto:
+    case PatternFormat::Native: ok = readNative(cells); break;
+    case PatternFormat::Rle: ok = readRle(cells); break;
+    case PatternFormat::Life106: ok = readLife106(cells); break;
+    case PatternFormat::Plaintext: ok = readPlaintext(cells); break;
+    case PatternFormat::Snapshot: break;
+    }
+
+    // Blocks are read ahead of the parser; give back what it did not use.
+    if (!m_device->isSequential())
+        m_device->seek(start + bytesRead());
+    return ok;
+}
+
+// Parses the rest of a file in place when it can be mapped; refill() then
+// has nothing more to read.
+void PatternReader::map()
+{
+    auto *file = qobject_cast<QFileDevice*>(m_device);
+    if (!file || file->isSequential())
+        return;
+
+    qint64 start = file->pos(), size = file->size() - start;
+    if (size <= 0)
+        return;
+
+    m_map = file->map(start, size);
+    if (!m_map)
+        return;
+
+    m_mappedFile = file;
+    m_begin = m_pos = reinterpret_cast<const char*>(m_map);
+    m_end = m_begin + size;
+}
+
+bool PatternReader::refill()
+{
+    if (m_map)
+        return false;
+
+    m_offset += m_end - m_begin;
+    m_buffer.resize(ChunkSize);
+    qint64 n = m_device->read(m_buffer.data(), ChunkSize);
+    m_buffer.resize(int(std::max<qint64>(n, 0)));
+    m_begin = m_pos = m_buffer.constData();
+    m_end = m_begin + m_buffer.size();
+    return m_pos != m_end;
+}
+
+void PatternReader::skipSpaces()
+{
+    for (int c = peek(); c == ' ' || c == '\t' || c == '\r'; c = peek())
+        ++m_pos;
+}
+
+void PatternReader::skipWhiteSpace()
+{
+    for (int c = peek(); c == ' ' || c == '\t' || c == '\r' || c == '\n'; c = peek())
+        ++m_pos;
+}
+
+void PatternReader::skipLine()
+{
+    for (;;) {
+        if (m_pos == m_end && !refill())
+            return;
+        const char *newline = static_cast<const char*>(std::memchr(m_pos, '\n', m_end - m_pos));
+        if (newline) {
+            m_pos = newline + 1;
+            return;
+        }
+        m_pos = m_end;
+    }
+}
+
+bool PatternReader::expect(char c)
+{
+    skipSpaces();
+    if (get() != c)
+        return fail(QString("expected '%1'").arg(c));
+    return true;
+}
+
+// Reads an optionally negative decimal number, after any spaces and tabs.
+bool PatternReader::readNumber(qint64& value)
+{
+    skipSpaces();
+    bool negative = peek() == '-';
+    if (negative)
+        ++m_pos;
+    if (!isDigit(peek()))
+        return fail("expected a number");
+
+    // Digits are scanned a block at a time; a number may span two blocks.
+    value = 0;
+    do {
+        const char *p = m_pos;
+        while (p != m_end && isDigit(*p)) {
+            value = value * 10 + (*p++ - '0');
+            if (value > INT_MAX) {
+                m_pos = p;
+                return fail("number out of range");
+            }
+        }
+        m_pos = p;
+    } while (m_pos == m_end && isDigit(peek()));
+
+    if (negative)
+        value = -value;
+    return true;
+}
+
+bool PatternReader::fail(const QString& error)
+{
+    m_error = QString("%1 at byte %2").arg(error).arg(bytesRead());
+    return false;
+}
+
+bool PatternReader::readNative(CellBitSet& cells)
+{
+    qint64 cols, rows, count;
+    skipWhiteSpace();
+    if (!readNumber(cols) || !readNumber(rows))
+        return false;
+    if (cols <= 0 || rows <= 0 || cols > MaxSize || rows > MaxSize)
+        return fail("invalid size");
+
+    cells = CellBitSet(QSize(int(cols), int(rows)));
+    skipWhiteSpace();
+    if (!readNumber(count))
+        return false;
+    if (count < 0)
+        return fail("invalid cell count");
+
+    for (qint64 i = 0; i < count; ++i) {
+        qint64 x, y;
+        skipWhiteSpace();
+        if (!readNumber(x) || !readNumber(y))
+            return false;
+        if (x < 0 || y < 0 || x >= cols || y >= rows)
+            return fail("cell outside the grid");
+        cells.set(QPoint(int(x), int(y)), true);
+    }
+
+    return true;
+}
+
+bool PatternReader::readRle(CellBitSet& cells)
+{
+    // Comments, then the "x = m, y = n[, rule = ...]" header.
+    for (;;) {
+        skipWhiteSpace();
+        if (peek() != '#')
+            break;
+        skipLine();
+    }
+
+    qint64 cols, rows;
+    if (!expect('x') || !expect('=') || !readNumber(cols)
+        || !expect(',') || !expect('y') || !expect('=') || !readNumber(rows))
+        return false;
+    if (cols < 0 || rows < 0 || cols > MaxSize || rows > MaxSize)
+        return fail("invalid size");
+
+    QByteArray rule;
+    for (int c = get(); c >= 0 && c != '\n'; c = get())
+        if (c != ' ' && c != '\t' && c != '\r')
+            rule += char(c);
+    rule = rule.toLower();
+    if (!rule.isEmpty() && rule != ",rule=b3/s23" && rule != ",rule=23/3")
+        qWarning() << "PatternReader::readRle: ignoring rule" << rule;
+
+    cells = CellBitSet(QSize(std::max<int>(int(cols), 1), std::max<int>(int(rows), 1)));
+
+    qint64 x = 0, y = 0;
+    for (;;) {
+        skipWhiteSpace();
+        int c = peek();
+        if (c < 0 || c == '!')
+            break;
+
+        qint64 count = 1;
+        if (isDigit(c) && !readNumber(count))
+            return false;
+
+        c = get();
+        if (c == '$') {
+            y += count;
+            x = 0;
+        } else if (c == 'b' || c == '.') {
+            x += count;
+        } else if (c == 'o' || (c >= 'A' && c <= 'Z')) {
+            if (y >= rows || x + count > cols)
+                return fail("cell outside the declared size");
+            setRun(cells, int(y), int(x), int(count));
+            x += count;
+        } else if (c == '#') {
+            skipLine();
+        } else {
+            return fail(QString("unexpected character '%1'").arg(QChar(c)));
+        }
+
+        if (x > cols)
+            x = cols;
+        if (y > rows)
+            y = rows;
+    }
+
+    return true;
+}
+
+bool PatternReader::readLife106(CellBitSet& cells)
+{
+    QVector<QPoint> points;
+
+    for (;;) {
+        skipWhiteSpace();
+        int c = peek();
+        if (c < 0)
+            break;
+        if (c == '#') {
+            skipLine();
+            continue;
+        }
+
+        qint64 x, y;
+        if (!readNumber(x) || !readNumber(y))
+            return false;
+        points += QPoint(int(x), int(y));
+    }
+
+    return fromPoints(points, cells);
+}
+
+bool PatternReader::readPlaintext(CellBitSet& cells)
+{
+    QVector<QPoint> points;
+    int x = 0, y = 0, cols = 0;
+
+    for (;;) {
+        int c = get();
+        if (c < 0)
+            break;
+
+        if (c == '!' && x == 0) {
+            skipLine();
+        } else if (c == '\n') {
+            ++y;
+            x = 0;
+        } else if (c == '.') {
+            cols = std::max(cols, ++x);
+        } else if (c == 'O' || c == '*') {
+            points += QPoint(x, y);
+            cols = std::max(cols, ++x);
+        } else if (c != '\r' && c != ' ' && c != '\t') {
+            return fail(QString("unexpected character '%1'").arg(QChar(c)));
+        }
+
+        if (x > MaxSize || y > MaxSize)
+            return fail("pattern too large");
+    }
+
+    cells = CellBitSet(QSize(std::max(cols, 1), std::max(x > 0 ? y + 1 : y, 1)));
+    for (const QPoint& point : points)
+        cells.set(point, true);
+    return true;
+}
+
+// Sizes `cells' to the bounding box of `points' and sets them, shifted so
+// that the box starts at the origin.
+bool PatternReader::fromPoints(const QVector<QPoint>& points, CellBitSet& cells)
+{
+    if (points.isEmpty()) {
+        cells = CellBitSet(QSize(1, 1));
+        return true;
+    }
+
+    qint64 minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+    for (const QPoint& point : points) {
+        minX = std::min<qint64>(minX, point.x());
+        minY = std::min<qint64>(minY, point.y());
+        maxX = std::max<qint64>(maxX, point.x());
+        maxY = std::max<qint64>(maxY, point.y());
+    }
+    if (maxX - minX >= MaxSize || maxY - minY >= MaxSize)
+        return fail("pattern too large");
+
+    cells = CellBitSet(QSize(int(maxX - minX + 1), int(maxY - minY + 1)));
+    for (const QPoint& point : points)
+        cells.set(QPoint(int(point.x() - minX), int(point.y() - minY)), true);
+    return true;
+}
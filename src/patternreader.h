@@ -0,0 +1,77 @@
+#ifndef PATTERNREADER_H_INCLUDED
+#define PATTERNREADER_H_INCLUDED
+
+#include <QByteArray>
+#include <QPoint>
+#include <QString>
+#include <QVector>
+#include "cellbitset.h"
+#include "patternformat.h"
+
+class QFileDevice;
+class QIODevice;
+
+// Reads patterns from a device in ChunkSize blocks, parsing the raw bytes
+// directly.  Files are memory-mapped instead when possible.  Nothing is
+// allocated per cell except for the formats that do not declare their size
+// up front.
+class PatternReader
+{
+public:
+    static constexpr int ChunkSize = 64 * 1024;
+    // Largest accepted pattern width and height.
+    static constexpr int MaxSize = 1 << 16;
+    // Bytes looked at to detect the format.
+    static constexpr int DetectSize = 4096;
+
+    explicit PatternReader(QIODevice *device);
+    ~PatternReader();
+
+    // Reads a whole pattern into `cells', sized to fit it (at least 1x1).
+    // Seekable devices are left positioned just past the pattern.
+    bool read(CellBitSet& cells, PatternFormat format = PatternFormat::Auto);
+    QString errorString() const { return m_error; }
+    qint64 bytesRead() const { return m_offset + (m_pos - m_begin); }
+
+private:
+    int peek()
+    {
+        if (m_pos == m_end && !refill())
+            return -1;
+        return static_cast<unsigned char>(*m_pos);
+    }
+    int get()
+    {
+        int ret = peek();
+        if (ret >= 0)
+            ++m_pos;
+        return ret;
+    }
+    void map();
+    bool refill();
+    void skipSpaces();
+    void skipWhiteSpace();
+    void skipLine();
+    bool expect(char c);
+    bool readNumber(qint64& value);
+    bool fail(const QString& error);
+
+    bool readNative(CellBitSet& cells);
+    bool readRle(CellBitSet& cells);
+    bool readLife106(CellBitSet& cells);
+    bool readPlaintext(CellBitSet& cells);
+    bool fromPoints(const QVector<QPoint>& points, CellBitSet& cells);
+
+    QIODevice *m_device;
+    QFileDevice *m_mappedFile = nullptr;
+    uchar *m_map = nullptr;
+    QByteArray m_buffer;
+    // The block being parsed, and the device offset of its start.
+    const char *m_begin = nullptr;
+    const char *m_pos = nullptr;
+    const char *m_end = nullptr;
+    qint64 m_offset = 0;
+    QString m_error;
+};
+
+#endif /* PATTERNREADER_H_INCLUDED */
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <QIODevice>
+#include <QVector>
+#include <QtAlgorithms>
+#include "patternwriter.h"
+#include "snapshot.h"
+
+namespace {
+    using Word = CellBitSet::Word;
+
+    bool testBit(const Word *row, int x)
+    {
+        return (row[x / CellBitSet::WordBits] >> (x % CellBitSet::WordBits)) & 1;
+    }
+
+    // The first column from x on, before `end', not in the given state.
+    int runEnd(const Word *row, int x, int end, bool state)
+    {
+        while (x < end) {
+            int bit = x % CellBitSet::WordBits;
+            Word word = row[x / CellBitSet::WordBits];
+            Word bits = (state ? ~word : word) >> bit;
+            if (bits != 0)
+                return std::min<int>(end, x + qCountTrailingZeroBits(bits));
+            x += CellBitSet::WordBits - bit;
+        }
+        return end;
+    }
+}
+
+PatternWriter::PatternWriter(QIODevice *device)
+    : m_device(device),
+      m_buffer(ChunkSize, Qt::Uninitialized)
+{ }
+
+bool PatternWriter::write(const CellBitSet& cells, PatternFormat format)
+{
+    if (format == PatternFormat::Snapshot)
+        return Snapshot::write(m_device, cells);
+
+    QRect bounds = boundingRect(cells);
+    m_ok = true;
+    m_lineLength = 0;
+
+    switch (format) {
+    case PatternFormat::Auto:
+    case PatternFormat::Native: writeNative(cells, bounds); break;
+    case PatternFormat::Rle: writeRle(cells, bounds); break;
+    case PatternFormat::Life106: writeLife106(cells, bounds); break;
+    case PatternFormat::Plaintext: writePlaintext(cells, bounds); break;
+    case PatternFormat::Snapshot: break;
+    }
+
+    return flush();
+}
+
+QRect PatternWriter::boundingRect(const CellBitSet& cells)
+{
+    const int words = cells.wordsPerRow();
+    QVector<Word> columns(words, 0);
+    const Word mask = cells.lastWordMask();
+    int top = -1, bottom = -1;
+
+    for (int y = 0; y < cells.rows(); ++y) {
+        const Word *row = cells.row(y);
+        Word any = 0;
+        for (int w = 0; w < words; ++w) {
+            const Word word = w == words - 1 ? row[w] & mask : row[w];
+            columns[w] |= word;
+            any |= word;
+        }
+        if (any) {
+            if (top < 0)
+                top = y;
+            bottom = y;
+        }
+    }
+
+    if (top < 0)
+        return QRect();
+
+    int first = 0, last = cells.wordsPerRow() - 1;
+    while (columns.at(first) == 0)
+        ++first;
+    while (columns.at(last) == 0)
+        --last;
+
+    int left = first * CellBitSet::WordBits + qCountTrailingZeroBits(columns.at(first));
+    int right = last * CellBitSet::WordBits + CellBitSet::WordBits - 1
+        - qCountLeadingZeroBits(columns.at(last));
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+void PatternWriter::put(const char *text)
+{
+    while (*text)
+        put(*text++);
+}
+
+void PatternWriter::putNumber(qint64 value)
+{
+    char digits[MaxNumberLength];
+    int n = 0;
+    bool negative = value < 0;
+    quint64 magnitude = negative ? 0 - quint64(value) : quint64(value);
+
+    do {
+        digits[n++] = char('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    char *out = reserve(MaxNumberLength + 1);
+    if (negative)
+        *out++ = '-';
+    while (n > 0)
+        *out++ = digits[--n];
+    m_used = int(out - m_buffer.constData());
+}
+
+bool PatternWriter::flush()
+{
+    if (m_used > 0 && m_device->write(m_buffer.constData(), m_used) != m_used)
+        m_ok = false;
+    m_used = 0;
+    return m_ok;
+}
+
+void PatternWriter::writeNative(const CellBitSet& cells, const QRect& bounds)
+{
+    if (bounds.isNull()) {
+        put("1 1\n0\n");
+        return;
+    }
+
+    putNumber(bounds.width());
+    put(' ');
+    putNumber(bounds.height());
+    put('\n');
+    putNumber(cells.count());
+    for (const QPoint& cell : cells) {
+        put('\n');
+        putNumber(cell.x() - bounds.left());
+        put(' ');
+        putNumber(cell.y() - bounds.top());
+    }
+    put("\n\n");
+}
+
+void PatternWriter::writeRle(const CellBitSet& cells, const QRect& bounds)
+{
+    put("x = ");
+    putNumber(bounds.width());
+    put(", y = ");
+    putNumber(bounds.height());
+    put(", rule = B3/S23\n");
+
+    // Runs of dead cells ending a row are left out, and row ends are only
+    // written once the next live cell is reached.
+    qint64 rowEnds = 0;
+    for (int y = bounds.top(); y <= bounds.bottom() && !bounds.isNull(); ++y) {
+        const Word *row = cells.row(y);
+        int x = bounds.left(), end = bounds.right() + 1;
+
+        while (x < end) {
+            bool state = testBit(row, x);
+            int next = runEnd(row, x, end, state);
+            if (!state && next == end)
+                break;
+            if (rowEnds > 0) {
+                putRleRun(rowEnds, '$');
+                rowEnds = 0;
+            }
+            putRleRun(next - x, state ? 'o' : 'b');
+            x = next;
+        }
+        ++rowEnds;
+    }
+
+    put("!\n");
+}
+
+void PatternWriter::putRleRun(qint64 count, char tag)
+{
+    int length = 1;
+    if (count > 1)
+        for (qint64 n = count; n > 0; n /= 10)
+            ++length;
+
+    if (m_lineLength + length > RleLineLength) {
+        put('\n');
+        m_lineLength = 0;
+    }
+    if (count > 1)
+        putNumber(count);
+    put(tag);
+    m_lineLength += length;
+}
+
+void PatternWriter::writeLife106(const CellBitSet& cells, const QRect& bounds)
+{
+    put("#Life 1.06\n");
+    for (const QPoint& cell : cells) {
+        putNumber(cell.x() - bounds.left());
+        put(' ');
+        putNumber(cell.y() - bounds.top());
+        put('\n');
+    }
+}
+
+void PatternWriter::writePlaintext(const CellBitSet& cells, const QRect& bounds)
+{
+    // An empty comment line keeps the format recognizable for empty patterns.
+    put("!\n");
+    for (int y = bounds.top(); y <= bounds.bottom() && !bounds.isNull(); ++y) {
+        const Word *row = cells.row(y);
+        int last = bounds.right();
+        while (last >= bounds.left() && !testBit(row, last))
+            --last;
+
+        if (last < bounds.left())
+            put('.');
+        for (int x = bounds.left(); x <= last; ++x)
+            put(testBit(row, x) ? 'O' : '.');
+        put('\n');
+    }
+}
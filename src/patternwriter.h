@@ -0,0 +1,62 @@
+#ifndef PATTERNWRITER_H_INCLUDED
+#define PATTERNWRITER_H_INCLUDED
+
+#include <QByteArray>
+#include <QRect>
+#include "cellbitset.h"
+#include "patternformat.h"
+
+class QIODevice;
+
+// Writes the bounding box of a set of cells to a device.  The text is
+// formatted straight into a preallocated block of ChunkSize bytes, which is
+// handed to the device whenever it fills up.
+class PatternWriter
+{
+public:
+    static constexpr int ChunkSize = 64 * 1024;
+    // RLE lines are wrapped before this many characters.
+    static constexpr int RleLineLength = 70;
+
+    explicit PatternWriter(QIODevice *device);
+
+    // Snapshots hold the whole bit set rather than its bounding box.
+    bool write(const CellBitSet& cells, PatternFormat format = PatternFormat::Native);
+
+    // The smallest rectangle holding all live cells; null if there are none.
+    static QRect boundingRect(const CellBitSet& cells);
+
+private:
+    // Longest text putNumber() writes.
+    static constexpr int MaxNumberLength = 20;
+
+    // Room for at least `n' more bytes.
+    char *reserve(int n)
+    {
+        if (m_used + n > ChunkSize)
+            flush();
+        return m_buffer.data() + m_used;
+    }
+    void put(char c)
+    {
+        *reserve(1) = c;
+        ++m_used;
+    }
+    void put(const char *text);
+    void putNumber(qint64 value);
+    bool flush();
+
+    void writeNative(const CellBitSet& cells, const QRect& bounds);
+    void writeRle(const CellBitSet& cells, const QRect& bounds);
+    void writeLife106(const CellBitSet& cells, const QRect& bounds);
+    void writePlaintext(const CellBitSet& cells, const QRect& bounds);
+    void putRleRun(qint64 count, char tag);
+
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    int m_used = 0;
+    int m_lineLength = 0;
+    bool m_ok = true;
+};
+
+#endif /* PATTERNWRITER_H_INCLUDED */
@@ -0,0 +1,98 @@
+#include "grid.h"
+#include "packedkernel.h"
+#include "planeengine.h"
+
+PlaneEngine::PlaneEngine(const QSharedPointer<SparsePlane>& plane)
+    : m_plane(plane ? plane : QSharedPointer<SparsePlane>::create())
+{ }
+
+QString PlaneEngine::describe()
+{
+    return QString("window onto an unbounded plane (%1)").arg(PackedKernel::active().name());
+}
+
+void PlaneEngine::nextGeneration(const Grid& grid, ChangeSet& changes)
+{
+    using Word = SparsePlane::Word;
+    const CellBitSet& cells = grid.cells();
+
+    changes.clear();
+
+    if (!m_started || m_window != cells.size()) {
+        // A window resized mid-run no longer lines up with the plane.
+        if (m_started)
+            m_plane->clear();
+        copyWindow(grid);
+        m_window = cells.size();
+        m_started = true;
+    }
+
+    m_changedOffGrid = false;
+    if (!m_plane->step())
+        return;
+
+    // Tile columns line up with the words of the grid rows, so each changed
+    // tile inside the window maps to one word in each of its rows.
+    const int words = cells.wordsPerRow();
+    const Word lastMask = cells.lastWordMask();
+
+    for (const SparsePlane::TileKey& key : m_plane->changedTiles()) {
+        if (key.x < 0 || key.y < 0 || key.x >= words
+            || key.y * SparsePlane::TileSize >= cells.rows()) {
+            m_changedOffGrid = true;
+            continue;
+        }
+
+        const int word = int(key.x);
+        const Word mask = word == words - 1 ? lastMask : ~Word(0);
+        const int top = int(key.y) * SparsePlane::TileSize;
+        const int bottom = qMin(top + SparsePlane::TileSize, cells.rows());
+        // Tiles on the right and bottom edge stick out of the window.
+        if (mask != ~Word(0) || bottom - top < SparsePlane::TileSize)
+            m_changedOffGrid = true;
+
+        for (int y = top; y < bottom; ++y) {
+            Word before = cells.row(y)[word] & mask;
+            Word after = m_plane->tileRow(key, y - top) & mask;
+            for (Word bits = before ^ after; bits; bits &= bits - 1) {
+                QPoint cell(word * CellBitSet::WordBits + qCountTrailingZeroBits(bits), y);
+                if (after >> (cell.x() % CellBitSet::WordBits) & 1)
+                    changes.spawned += cell;
+                else
+                    changes.died += cell;
+            }
+        }
+    }
+}
+
+ChangeSet PlaneEngine::advance(const Grid& grid, quint64 generations)
+{
+    m_beforeAdvance.reset(new SparsePlane(*m_plane));
+    return Engine::advance(grid, generations);
+}
+
+void PlaneEngine::discardAdvance()
+{
+    if (!m_beforeAdvance)
+        return;
+
+    m_plane->swap(*m_beforeAdvance);
+    m_beforeAdvance.reset();
+    // The grid stayed where it was, so the window is taken over again.
+    m_started = false;
+}
+
+void PlaneEngine::copyWindow(const Grid& grid)
+{
+    const int cols = grid.cols(), rows = grid.rows();
+    QVector<QPoint> stale;
+    m_plane->forEachCell([&] (qint64 x, qint64 y) {
+        if (x >= 0 && y >= 0 && x < cols && y < rows)
+            stale += QPoint(int(x), int(y));
+    });
+
+    for (const QPoint& cell : stale)
+        m_plane->set(cell.x(), cell.y(), false);
+    for (const QPoint& cell : grid)
+        m_plane->set(cell.x(), cell.y(), true);
+}
@@ -0,0 +1,43 @@
+#ifndef PLANEENGINE_H_INCLUDED
+#define PLANEENGINE_H_INCLUDED
+
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QSize>
+#include "engine.h"
+#include "sparseplane.h"
+
+// Runs the simulation on an unbounded SparsePlane.  The grid is only a fixed
+// window onto the plane: patterns leaving it keep evolving outside and may
+// come back, instead of dying at the border, but they are neither shown nor
+// saved.  On the first step the window of the
+// plane is overwritten with the grid, so edits made between runs are taken
+// over while the cells outside stay where they are.
+class PlaneEngine : public Engine
+{
+public:
+    explicit PlaneEngine(const QSharedPointer<SparsePlane>& plane = QSharedPointer<SparsePlane>());
+
+    static QString describe();
+
+    virtual QString name() const override { return describe(); }
+    virtual void nextGeneration(const Grid& grid, ChangeSet& changes) override;
+    virtual bool changedOffGrid() const override { return m_changedOffGrid; }
+    virtual ChangeSet advance(const Grid& grid, quint64 generations) override;
+    virtual void discardAdvance() override;
+
+    // For reporting; the plane is not saved or shown beyond the window.
+    const SparsePlane& plane() const { return *m_plane; }
+
+private:
+    void copyWindow(const Grid& grid);
+
+    QSharedPointer<SparsePlane> m_plane;
+    // The plane before the last advance().
+    QScopedPointer<SparsePlane> m_beforeAdvance;
+    QSize m_window;
+    bool m_started = false;
+    bool m_changedOffGrid = false;
+};
+
+#endif /* PLANEENGINE_H_INCLUDED */
@@ -0,0 +1,159 @@
+#include <cstring>
+#include <QBuffer>
+#include <QMutexLocker>
+#include <QtDebug>
+#include <QtEndian>
+#include "recorder.h"
+#include "snapshot.h"
+
+Recorder::Recorder(QObject *parent)
+    : QThread(parent)
+{ }
+
+Recorder::~Recorder()
+{
+    finish();
+    wait();
+}
+
+bool Recorder::open(const QString& fileName, const CellBitSet& initial, quint64 generation,
+                    int keyframeInterval)
+{
+    Q_ASSERT(!isRunning());
+    Q_ASSERT(keyframeInterval > 0);
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    Recording::FileHeader header;
+    std::memset(&header, 0, sizeof header);
+    std::memcpy(header.magic, Recording::Magic, sizeof Recording::Magic);
+    header.version = qToLittleEndian(Recording::Version);
+    header.keyframeInterval = qToLittleEndian(quint32(keyframeInterval));
+    header.cols = qToLittleEndian(qint32(initial.cols()));
+    header.rows = qToLittleEndian(qint32(initial.rows()));
+    if (m_file.write(reinterpret_cast<const char*>(&header), sizeof header) != sizeof header) {
+        m_file.close();
+        return false;
+    }
+
+    m_cells = initial;
+    m_generation = generation;
+    m_lastKeyframe = generation;
+    m_keyframeInterval = keyframeInterval;
+    m_index.clear();
+    m_pending.clear();
+    m_pendingBytes = 0;
+    m_finishing = false;
+
+    start();
+    return true;
+}
+
+void Recorder::record(const ChangeSet& changes, quint64 generations)
+{
+    QByteArray encoded = Recording::encodeChanges(changes.died, changes.spawned);
+    {
+        QMutexLocker lock(&m_mutex);
+        while (m_pendingBytes >= MaxPendingBytes && !m_finishing)
+            m_drained.wait(&m_mutex);
+        m_pendingBytes += encoded.size();
+        m_pending += Pending{encoded, generations};
+    }
+    m_cond.wakeOne();
+}
+
+void Recorder::finish()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_finishing = true;
+    }
+    m_cond.wakeOne();
+    m_drained.wakeAll();
+}
+
+void Recorder::run()
+{
+    bool ok = writeKeyframe();
+    QVector<Pending> batch;
+
+    while (true) {
+        {
+            QMutexLocker lock(&m_mutex);
+            while (m_pending.isEmpty() && !m_finishing)
+                m_cond.wait(&m_mutex);
+            if (m_pending.isEmpty())
+                break;
+            batch.swap(m_pending);
+            m_pendingBytes = 0;
+        }
+        m_drained.wakeAll();
+
+        // After a write error the changes are still drained, so that the
+        // queue does not grow for the rest of the run.
+        for (const Pending& changes : batch) {
+            if (!ok)
+                break;
+
+            m_generation += changes.generations;
+            ok = Recording::applyChanges(changes.changes, m_cells)
+                && writeRecord(Recording::Changes, qCompress(changes.changes));
+            if (ok && m_generation - m_lastKeyframe >= quint64(m_keyframeInterval))
+                ok = writeKeyframe();
+        }
+        batch.clear();
+        if (ok)
+            ok = m_file.flush();
+    }
+
+    if (ok)
+        ok = writeIndex();
+    if (!ok)
+        qWarning() << "Recorder::run: failed writing" << m_file.fileName() << ":"
+                   << m_file.errorString();
+    m_file.close();
+}
+
+bool Recorder::writeRecord(Recording::RecordType type, const QByteArray& payload)
+{
+    Recording::RecordHeader header;
+    header.type = qToLittleEndian(quint32(type));
+    header.size = qToLittleEndian(quint32(payload.size()));
+    header.generation = qToLittleEndian(m_generation);
+
+    return m_file.write(reinterpret_cast<const char*>(&header), sizeof header) == sizeof header
+        && m_file.write(payload) == payload.size();
+}
+
+bool Recorder::writeKeyframe()
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    if (!Snapshot::write(&buffer, m_cells, m_generation))
+        return false;
+
+    m_index += Recording::IndexEntry{m_generation, quint64(m_file.pos())};
+    m_lastKeyframe = m_generation;
+    return writeRecord(Recording::Keyframe, qCompress(buffer.data()));
+}
+
+bool Recorder::writeIndex()
+{
+    Recording::Trailer trailer;
+    std::memcpy(trailer.magic, Recording::IndexMagic, sizeof Recording::IndexMagic);
+    trailer.indexOffset = qToLittleEndian(quint64(m_file.pos()));
+    trailer.keyframes = qToLittleEndian(quint64(m_index.size()));
+    trailer.lastGeneration = qToLittleEndian(m_generation);
+
+    for (Recording::IndexEntry entry : m_index) {
+        entry.generation = qToLittleEndian(entry.generation);
+        entry.offset = qToLittleEndian(entry.offset);
+        if (m_file.write(reinterpret_cast<const char*>(&entry), sizeof entry) != sizeof entry)
+            return false;
+    }
+
+    return m_file.write(reinterpret_cast<const char*>(&trailer), sizeof trailer) == sizeof trailer
+        && m_file.flush();
+}
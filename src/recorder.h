@@ -0,0 +1,80 @@
+#ifndef RECORDER_H_INCLUDED
+#define RECORDER_H_INCLUDED
+
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include "cellbitset.h"
+#include "changeset.h"
+#include "recording.h"
+
+// Writes a run to a Recording on its own thread.  record() encodes the change
+// set into a buffer of the recorder's own, leaving the caller's vectors
+// unshared for reuse; compression and writing happen here.  Up to
+// MaxPendingBytes of encoded changes are queued, beyond which record() waits
+// for the disk, so memory and the time finish() takes stay bounded.
+//
+// The thread keeps its own copy of the grid, updated from the queued
+// changes, to write a keyframe every keyframeInterval generations.  What has
+// been written is flushed after every batch, so the file can be replayed
+// while the recording goes on.
+class Recorder : public QThread
+{
+    Q_OBJECT
+public:
+    static constexpr int DefaultKeyframeInterval = 1000;
+    static constexpr int MaxPendingBytes = 64 << 20;
+
+    Recorder(QObject *parent = nullptr);
+    // Finishes the recording first.
+    virtual ~Recorder();
+
+    // Creates the file, replacing any old one, and starts recording from
+    // `initial' at `generation'.
+    bool open(const QString& fileName, const CellBitSet& initial, quint64 generation = 0,
+              int keyframeInterval = DefaultKeyframeInterval);
+    QString errorString() const { return m_file.errorString(); }
+    QString fileName() const { return m_file.fileName(); }
+
+    // Queues the changes leading to the next `generations' generations, or
+    // edits made in the current one if zero.  May be called from any thread.
+    void record(const ChangeSet& changes, quint64 generations = 1);
+
+    // Writes what is still queued and the index, and closes the file.
+    // Returns at once; the thread finishes when done.
+    void finish();
+
+protected:
+    virtual void run() override;
+
+private:
+    struct Pending
+    {
+        // As Recording::encodeChanges() writes them.
+        QByteArray changes;
+        quint64 generations;
+    };
+
+    bool writeRecord(Recording::RecordType type, const QByteArray& payload);
+    bool writeKeyframe();
+    bool writeIndex();
+
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    QWaitCondition m_drained;
+    QVector<Pending> m_pending;
+    int m_pendingBytes = 0;
+    bool m_finishing = false;
+
+    // Owned by the recording thread once it runs.
+    QFile m_file;
+    CellBitSet m_cells;
+    quint64 m_generation = 0;
+    quint64 m_lastKeyframe = 0;
+    int m_keyframeInterval = DefaultKeyframeInterval;
+    QVector<Recording::IndexEntry> m_index;
+};
+
+#endif /* RECORDER_H_INCLUDED */
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <cstring>
+#include <QBuffer>
+#include <QtDebug>
+#include <QtEndian>
+#include "recording.h"
+#include "snapshot.h"
+
+const char Recording::Magic[8] = {'L', 'I', 'F', 'E', 'R', 'E', 'C', '1'};
+const char Recording::IndexMagic[8] = {'L', 'I', 'F', 'E', 'I', 'D', 'X', '1'};
+
+QByteArray Recording::encodeChanges(const QVector<QPoint>& died, const QVector<QPoint>& spawned)
+{
+    QByteArray ret(int(2 * sizeof(quint32)) + (died.size() + spawned.size()) * 2 * int(sizeof(qint32)),
+                   Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar*>(ret.data());
+
+    qToLittleEndian(quint32(died.size()), out);
+    qToLittleEndian(quint32(spawned.size()), out + 4);
+    out += 8;
+    for (const QVector<QPoint> *cells : {&died, &spawned}) {
+        for (const QPoint& cell : *cells) {
+            qToLittleEndian(qint32(cell.x()), out);
+            qToLittleEndian(qint32(cell.y()), out + 4);
+            out += 8;
+        }
+    }
+    return ret;
+}
+
+bool Recording::fail(const QString& message)
+{
+    m_error = message;
+    return false;
+}
+
+bool Recording::open(const QString& fileName)
+{
+    m_file.close();
+    m_file.setFileName(fileName);
+    m_index.clear();
+    m_lastGeneration = 0;
+
+    if (!m_file.open(QIODevice::ReadOnly))
+        return fail(m_file.errorString());
+
+    FileHeader header;
+    if (m_file.read(reinterpret_cast<char*>(&header), sizeof header) != sizeof header
+        || std::memcmp(header.magic, Magic, sizeof Magic) != 0)
+        return fail("not a recording");
+    if (qFromLittleEndian(header.version) != Version)
+        return fail(QString("unsupported recording version %1")
+                    .arg(qFromLittleEndian(header.version)));
+
+    m_size = QSize(qFromLittleEndian(header.cols), qFromLittleEndian(header.rows));
+    if (m_size.isEmpty())
+        return fail("invalid recording size");
+
+    if (!readIndex()) {
+        qWarning() << "Recording::open:" << fileName << "has no index, scanning it";
+        scan();
+    }
+    if (m_index.isEmpty())
+        return fail("recording has no keyframes");
+    return true;
+}
+
+quint64 Recording::firstGeneration() const
+{
+    return m_index.isEmpty() ? 0 : m_index.first().generation;
+}
+
+bool Recording::readIndex()
+{
+    const qint64 size = m_file.size();
+    if (size < qint64(sizeof(FileHeader) + sizeof(Trailer)))
+        return false;
+
+    Trailer trailer;
+    if (!m_file.seek(size - qint64(sizeof trailer))
+        || m_file.read(reinterpret_cast<char*>(&trailer), sizeof trailer) != sizeof trailer
+        || std::memcmp(trailer.magic, IndexMagic, sizeof IndexMagic) != 0)
+        return false;
+
+    const quint64 offset = qFromLittleEndian(trailer.indexOffset);
+    const quint64 count = qFromLittleEndian(trailer.keyframes);
+    if (offset < sizeof(FileHeader)
+        || offset + count * sizeof(IndexEntry) != quint64(size) - sizeof trailer)
+        return false;
+
+    QVector<IndexEntry> index(static_cast<int>(count));
+    if (!m_file.seek(qint64(offset))
+        || m_file.read(reinterpret_cast<char*>(index.data()), qint64(count * sizeof(IndexEntry)))
+           != qint64(count * sizeof(IndexEntry)))
+        return false;
+
+    for (IndexEntry& entry : index) {
+        entry.generation = qFromLittleEndian(entry.generation);
+        entry.offset = qFromLittleEndian(entry.offset);
+        if (entry.offset < sizeof(FileHeader) || entry.offset >= offset)
+            return false;
+    }
+
+    m_index = index;
+    m_lastGeneration = qFromLittleEndian(trailer.lastGeneration);
+    return true;
+}
+
+// Walks the record headers without decompressing anything.  The walk stops
+// at the first record that does not fit in the file, which is where a crash
+// cut the recording short.
+void Recording::scan()
+{
+    m_index.clear();
+    m_file.seek(sizeof(FileHeader));
+
+    RecordHeader header;
+    qint64 offset = m_file.pos();
+    while (readRecordHeader(header)) {
+        if (header.type == Keyframe)
+            m_index += IndexEntry{header.generation, quint64(offset)};
+        if (!m_index.isEmpty())
+            m_lastGeneration = header.generation;
+
+        offset = m_file.pos() + header.size;
+        if (!m_file.seek(offset))
+            break;
+    }
+}
+
+bool Recording::readRecordHeader(RecordHeader& header)
+{
+    if (m_file.read(reinterpret_cast<char*>(&header), sizeof header) != sizeof header)
+        return false;
+
+    header.type = qFromLittleEndian(header.type);
+    header.size = qFromLittleEndian(header.size);
+    header.generation = qFromLittleEndian(header.generation);
+    return (header.type == Keyframe || header.type == Changes)
+        && header.size <= quint64(m_file.size() - m_file.pos());
+}
+
+bool Recording::readPayload(const RecordHeader& header, QByteArray& payload)
+{
+    payload = m_file.read(header.size);
+    if (payload.size() != int(header.size))
+        return false;
+    payload = qUncompress(payload);
+    return !payload.isEmpty();
+}
+
+bool Recording::applyChanges(const QByteArray& payload, CellBitSet& cells)
+{
+    const uchar *in = reinterpret_cast<const uchar*>(payload.constData());
+    if (payload.size() < 8)
+        return false;
+
+    const quint32 died = qFromLittleEndian<quint32>(in);
+    const quint32 spawned = qFromLittleEndian<quint32>(in + 4);
+    if ((quint64(died) + spawned) * 8 != quint64(payload.size()) - 8)
+        return false;
+
+    in += 8;
+    for (quint32 i = 0; i < died + spawned; ++i, in += 8) {
+        QPoint cell(qFromLittleEndian<qint32>(in), qFromLittleEndian<qint32>(in + 4));
+        if (!cells.contains(cell))
+            return false;
+        cells.set(cell, i >= died);
+    }
+    return true;
+}
+
+bool Recording::seek(quint64 generation, CellBitSet& cells, quint64 *reached)
+{
+    auto it = std::upper_bound(m_index.constBegin(), m_index.constEnd(), generation,
+                               [] (quint64 generation, const IndexEntry& entry) {
+                                   return generation < entry.generation;
+                               });
+    if (it == m_index.constBegin())
+        return fail(QString("generation %1 is before the recording").arg(generation));
+    --it;
+
+    RecordHeader header;
+    QByteArray payload;
+    if (!m_file.seek(qint64(it->offset)) || !readRecordHeader(header)
+        || header.type != Keyframe || !readPayload(header, payload))
+        return fail(QString("corrupt keyframe at byte %1").arg(it->offset));
+
+    QBuffer buffer(&payload);
+    buffer.open(QIODevice::ReadOnly);
+    QString error;
+    CellBitSet state;
+    if (!Snapshot::read(&buffer, state, nullptr, &error))
+        return fail(QString("corrupt keyframe at byte %1: %2").arg(it->offset).arg(error));
+
+    quint64 current = it->generation;
+    while (current < generation) {
+        const qint64 offset = m_file.pos();
+        if (!readRecordHeader(header) || header.generation > generation)
+            break;
+        if (header.type == Keyframe) {
+            m_file.seek(m_file.pos() + header.size);
+            continue;
+        }
+        if (!readPayload(header, payload) || !applyChanges(payload, state))
+            return fail(QString("corrupt changes at byte %1").arg(offset));
+        current = header.generation;
+    }
+
+    cells = state;
+    if (reached)
+        *reached = current;
+    return true;
+}
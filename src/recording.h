@@ -0,0 +1,106 @@
+#ifndef RECORDING_H_INCLUDED
+#define RECORDING_H_INCLUDED
+
+#include <QByteArray>
+#include <QFile>
+#include <QPoint>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include "cellbitset.h"
+
+// A run recorded by Recorder, opened for replay.
+//
+// The file is append-only: a 32-byte header, then records of a 16-byte
+// header and a qCompress()ed payload.  Keyframe records hold a Snapshot of
+// the whole grid, change records the cells that died and spawned since the
+// previous record.  Closing the recording appends an index of the keyframes
+// and a trailer pointing to it.  A recording cut short has no index; it is
+// rebuilt by scanning the records, and a torn last record is ignored.
+//
+// Seeking loads the nearest keyframe at or before the generation and plays
+// the changes after it, so its cost is bounded by the keyframe interval.
+class Recording
+{
+public:
+    static const char Magic[8];
+    static const char IndexMagic[8];
+    static constexpr quint32 Version = 1;
+
+    enum RecordType : quint32
+    {
+        Keyframe = 1,
+        Changes = 2
+    };
+
+    // All fields are little-endian.
+    struct FileHeader
+    {
+        char magic[8];
+        quint32 version;
+        quint32 keyframeInterval;
+        qint32 cols;
+        qint32 rows;
+        char reserved[8];
+    };
+    static_assert(sizeof(FileHeader) == 32, "recording header must stay 32 bytes");
+
+    // `generation' is the one the grid is at after the record.  A change
+    // record may span several generations when the run jumped ahead.
+    struct RecordHeader
+    {
+        quint32 type;
+        quint32 size;
+        quint64 generation;
+    };
+    static_assert(sizeof(RecordHeader) == 16, "record header must stay 16 bytes");
+
+    struct IndexEntry
+    {
+        quint64 generation;
+        quint64 offset;
+    };
+
+    struct Trailer
+    {
+        quint64 indexOffset;
+        quint64 keyframes;
+        quint64 lastGeneration;
+        char magic[8];
+    };
+    static_assert(sizeof(Trailer) == 32, "recording trailer must stay 32 bytes");
+
+    // Payload of a change record, before compression.
+    static QByteArray encodeChanges(const QVector<QPoint>& died, const QVector<QPoint>& spawned);
+    // Applies such a payload; false if it is malformed or out of bounds.
+    static bool applyChanges(const QByteArray& payload, CellBitSet& cells);
+
+    bool open(const QString& fileName);
+    QString errorString() const { return m_error; }
+
+    QSize size() const { return m_size; }
+    quint64 firstGeneration() const;
+    quint64 lastGeneration() const { return m_lastGeneration; }
+    int keyframeCount() const { return m_index.size(); }
+
+    // Reconstructs the grid at `generation', or at the last recorded one
+    // before it when the run jumped over it.  `reached' is set to the
+    // generation actually reconstructed.
+    bool seek(quint64 generation, CellBitSet& cells, quint64 *reached = nullptr);
+
+private:
+    bool fail(const QString& message);
+    bool readRecordHeader(RecordHeader& header);
+    bool readPayload(const RecordHeader& header, QByteArray& payload);
+    bool readIndex();
+    void scan();
+
+    QFile m_file;
+    QString m_error;
+    QSize m_size;
+    QVector<IndexEntry> m_index;
+    quint64 m_lastGeneration = 0;
+};
+
+#endif /* RECORDING_H_INCLUDED */
@@ -0,0 +1,82 @@
+#include <climits>
+#include <QDialogButtonBox>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QSignalBlocker>
+#include <QSlider>
+#include <QSpinBox>
+#include <QVBoxLayout>
+#include <QtDebug>
+#include "grid.h"
+#include "replaydialog.h"
+
+ReplayDialog::ReplayDialog(Grid *grid, QWidget *parent)
+    : QDialog(parent),
+      m_grid(grid),
+      m_board(grid->cells()),
+      m_slider(new QSlider(Qt::Horizontal, this)),
+      m_spinBox(new QSpinBox(this)),
+      m_label(new QLabel(this))
+{
+    // Seeking replays up to a keyframe interval of changes, so the slider
+    // only seeks once released.
+    m_slider->setTracking(false);
+    m_spinBox->setAccelerated(true);
+
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    auto *controls = new QHBoxLayout;
+    controls->addWidget(m_slider, 1);
+    controls->addWidget(m_spinBox);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->addLayout(controls);
+    layout->addWidget(m_label);
+    layout->addWidget(buttons);
+
+    connect(m_slider, SIGNAL(valueChanged(int)), m_spinBox, SLOT(setValue(int)));
+    connect(m_spinBox, SIGNAL(valueChanged(int)), m_slider, SLOT(setValue(int)));
+    connect(m_spinBox, SIGNAL(valueChanged(int)), this, SLOT(showGeneration(int)));
+    connect(buttons, SIGNAL(rejected()), this, SLOT(reject()));
+}
+
+bool ReplayDialog::openRecording(const QString& fileName)
+{
+    if (!m_recording.open(fileName))
+        return false;
+
+    setWindowTitle(tr("Replay %1").arg(QFileInfo(fileName).fileName()));
+
+    const int first = int(qMin<quint64>(m_recording.firstGeneration(), INT_MAX));
+    const int last = int(qMin<quint64>(m_recording.lastGeneration(), INT_MAX));
+    {
+        const QSignalBlocker sliderBlocker(m_slider), spinBoxBlocker(m_spinBox);
+        m_slider->setRange(first, last);
+        m_spinBox->setRange(first, last);
+        m_slider->setPageStep(qMax(1, (last - first) / 20));
+        m_slider->setValue(first);
+        m_spinBox->setValue(first);
+    }
+    showGeneration(first);
+    return true;
+}
+
+void ReplayDialog::done(int result)
+{
+    m_grid->setCells(m_board);
+    QDialog::done(result);
+}
+
+void ReplayDialog::showGeneration(int generation)
+{
+    CellBitSet cells;
+    quint64 reached;
+    if (!m_recording.seek(quint64(generation), cells, &reached)) {
+        qWarning() << "ReplayDialog::showGeneration:" << m_recording.errorString();
+        m_label->setText(m_recording.errorString());
+        return;
+    }
+
+    m_grid->setCells(cells);
+    m_label->setText(tr("Generation %1 of %2").arg(reached).arg(m_recording.lastGeneration()));
+}
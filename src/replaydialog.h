@@ -0,0 +1,39 @@
+#ifndef REPLAYDIALOG_H_INCLUDED
+#define REPLAYDIALOG_H_INCLUDED
+
+#include <QDialog>
+#include "cellbitset.h"
+#include "recording.h"
+
+class Grid;
+class QLabel;
+class QSlider;
+class QSpinBox;
+
+// Shows any generation of a recorded run in a grid, chosen with a slider.
+// The grid is given back its own cells when the dialog closes.
+class ReplayDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    ReplayDialog(Grid *grid, QWidget *parent = nullptr);
+
+    bool openRecording(const QString& fileName);
+    QString errorString() const { return m_recording.errorString(); }
+
+public slots:
+    virtual void done(int result) override;
+
+private slots:
+    void showGeneration(int generation);
+
+private:
+    Grid *m_grid;
+    CellBitSet m_board;
+    Recording m_recording;
+    QSlider *m_slider;
+    QSpinBox *m_spinBox;
+    QLabel *m_label;
+};
+
+#endif /* REPLAYDIALOG_H_INCLUDED */
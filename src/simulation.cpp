@@ -1,54 +1,37 @@
 #include <QTimer>
+#include <QDebug>
 #include <QTime>
-#include <QWaitCondition>
-#include <QMutex>
-#include <QQueue>
-#include <QMutexLocker>
-#include <boost/optional.hpp>
-#include <boost/bimap/unordered_set_of.hpp>
-#include <boost/bimap/multiset_of.hpp>
-#include <boost/bimap.hpp>
+#include <QScopedPointer>
 #include <QThread>
+#include "changesetqueue.h"
+#include "recorder.h"
 #include "simulation.h"
+#include "sparseplane.h"
 
 static constexpr int MaxQueueSize = 512;
-
-class ChangeSet
-{
-public:
-    QVector<QPoint> died;
-    QVector<QPoint> spawned;
-
-    void apply(Grid *grid)
-    {
-        for (const QPoint& cell : spawned)
-            grid->setCellStateAt(cell, true);
-        for (const QPoint& cell : died)
-            grid->setCellStateAt(cell, false);
-    }
-};
+// Timer interval used in max speed mode, about one frame at 60Hz.
+static constexpr int FrameInterval = 16;
 
 class Worker : public QThread
 {
     Q_OBJECT
 public:
-    Worker(Grid *grid)
-        : m_grid(grid->clone())
+    Worker(Grid *grid, Engine *engine, quint64 jump = 0, Recorder *recorder = nullptr)
+        : m_grid(grid->clone()),
+          m_engine(engine),
+          m_jump(jump),
+          m_queue(MaxQueueSize),
+          m_recorder(recorder)
     {
         m_grid->setParent(this);
         moveToThread(this);
     }
 
-    boost::optional<ChangeSet> pop(unsigned long waitTime = ULONG_MAX);
+    ChangeSetQueue& queue() { return m_queue; }
 
     void stop()
     {
-        {
-            QMutexLocker lock(&m_mutex);
-            m_quit = true;
-        }
-
-        m_cond.wakeAll();
+        m_queue.close();
     }
 signals:
     void exhausted();
@@ -56,40 +39,58 @@ signals:
 protected:
     virtual void run() override
     {
-        while (true) {
-            ChangeSet cs = nextGeneration();
+        if (m_jump > 0) {
+            ChangeSet cs = m_engine->advance(*m_grid, m_jump);
+
+            // A jump cut short is dropped whole.  One that changed nothing
+            // is still recorded, so that the recording counts its
+            // generations.
+            ChangeSet *slot = isInterruptionRequested() ? nullptr : m_queue.reserve();
+            if (slot) {
+                if (m_recorder)
+                    m_recorder->record(cs, m_jump);
+                if (!cs.isEmpty()) {
+                    cs.apply(m_grid);
+                    *slot = std::move(cs);
+                    m_queue.commit();
+                }
+            }
+            else {
+                // The plane of the unbounded engine outlives the run, and has
+                // to stay at the generation of the grid.
+                m_engine->discardAdvance();
+            }
+        }
 
-            if (cs.died.empty() && cs.spawned.empty())
+        // The engine writes straight into the next free slot of the ring.
+        while (m_jump == 0) {
+            ChangeSet *cs = m_queue.reserve();
+            if (cs == nullptr)
                 break;
 
-            cs.apply(m_grid);
-
-            push(cs);
-            QMutexLocker lock(&m_mutex);
-            if (m_quit)
+            m_engine->nextGeneration(*m_grid, *cs);
+            if (cs->isEmpty() && !m_engine->changedOffGrid())
                 break;
-        }
 
-        while (true) {
-            QMutexLocker lock(&m_mutex);
-            if (m_quit || m_queue.isEmpty() || !m_cond.wait(&m_mutex))
-                break;
+            cs->apply(m_grid);
+            if (m_recorder)
+                m_recorder->record(*cs);
+            m_queue.commit();
         }
 
+        m_queue.waitUntilEmpty();
+
         emit exhausted();
 
         stop();
     }
 
 private:
-    bool push(const ChangeSet& elem);
-    ChangeSet nextGeneration();
-
     Grid *m_grid;
-    QQueue<ChangeSet> m_queue;
-    QMutex m_mutex;
-    QWaitCondition m_cond;
-    bool m_quit = false;
+    QScopedPointer<Engine> m_engine;
+    quint64 m_jump;
+    ChangeSetQueue m_queue;
+    Recorder *m_recorder;
 };
 
 // include the definitions for Worker.
@@ -101,11 +102,18 @@ Simulation::Simulation(Grid *grid, QObject *parent)
       m_timer(new QTimer(this))
 {
     connect(m_timer, SIGNAL(timeout()), this, SLOT(simulationStep()));
+    connect(m_grid, SIGNAL(sizeChanged(QSize, QSize)), this, SLOT(gridResized()));
 }
 
-void Simulation::startWorker()
+void Simulation::startWorker(quint64 jump)
 {
-    m_worker = new Worker(m_grid);
+    if (m_engineType == Engine::Type::Unbounded && !m_engineOptions.plane)
+        m_engineOptions.plane = QSharedPointer<SparsePlane>::create();
+    Engine *engine = Engine::create(m_engineType, m_engineOptions);
+    qDebug() << "Simulation::startWorker: stepping with" << engine->name();
+
+    updateRecording();
+    m_worker = new Worker(m_grid, engine, jump, m_recorder);
     connect(m_worker, SIGNAL(exhausted()), this, SLOT(stop()));
     connect(m_worker, SIGNAL(finished()), this, SLOT(waitForAndDeleteFinishedWorker()));
 
@@ -134,20 +142,40 @@ void Simulation::startOrDoSingleStep()
     m_timer->start(0);
 }
 
+void Simulation::jump(quint64 generations)
+{
+    if (generations == 0)
+        return;
+    if (isRunning())
+        stop();
+
+    startWorker(generations);
+    m_timer->setSingleShot(false);
+    m_timer->start(0);
+}
+
 void Simulation::stop()
 {
     if (m_worker == nullptr)
         return;
 
+    // Cuts a jump short rather than blocking until it is done.
+    m_worker->requestInterruption();
     m_worker->stop();
+    // Waited for first, so that a change set committed while the queue was
+    // closing is not lost; the engine has already stepped past it.
+    m_worker->wait();
 
-    while (true) {
-        if (auto changeset = m_worker->pop(0))
-            changeset->apply(m_grid);
-        else break;
+    ChangeSetQueue& queue = m_worker->queue();
+    while (ChangeSet *changeset = queue.front()) {
+        changeset->apply(m_grid);
+        queue.release();
     }
+    if (m_recorder)
+        m_recordedCells = m_grid->cells();
+    if (m_recorder && m_recorder->fileName() != m_recordingFile)
+        endRecording();
 
-    m_worker->wait();
     m_worker = nullptr;
     m_timer->stop();
 
@@ -162,6 +190,14 @@ void Simulation::reset()
     m_grid->copyStateFrom(m_preSimulationGrid);
     delete m_preSimulationGrid;
     m_preSimulationGrid = nullptr;
+    discardOffGridCells();
+    endRecording();
+}
+
+void Simulation::discardOffGridCells()
+{
+    // A running engine keeps its own reference.
+    m_engineOptions.plane.reset();
 }
 
 void Simulation::setDelay(int millis)
@@ -171,79 +207,175 @@ void Simulation::setDelay(int millis)
     m_delay = millis;
 }
 
-void Simulation::simulationStep()
+void Simulation::setMaxSpeed(bool enabled)
 {
-    if (auto changeset = m_worker->pop(100))
-        changeset->apply(m_grid);
-    m_timer->setInterval(m_delay);
+    m_maxSpeed = enabled;
 }
 
-void Simulation::waitForAndDeleteFinishedWorker()
+void Simulation::setRecordingFile(const QString& fileName)
 {
-    Worker *worker = qobject_cast<Worker*>(sender());
+    m_recordingFile = fileName;
+    // A running session ends when the run stops.
+    if (!isRunning() && m_recorder && m_recorder->fileName() != fileName)
+        endRecording();
+}
 
-    worker->wait();
-    delete worker;
+// A recording session spans the runs until the file changes, the grid is
+// resized or the simulation is reset.  Edits made between runs are recorded
+// as changes of no generations.
+void Simulation::updateRecording()
+{
+    if (m_recorder) {
+        if (m_recorder->fileName() == m_recordingFile
+            && m_recordedCells.size() == m_grid->cells().size()) {
+            ChangeSet edits = ChangeSet::difference(m_recordedCells, m_grid->cells());
+            if (!edits.isEmpty())
+                m_recorder->record(edits, 0);
+            return;
+        }
+        endRecording();
+    }
+
+    if (m_recordingFile.isEmpty())
+        return;
+
+    m_recorder = new Recorder(this);
+    if (!m_recorder->open(m_recordingFile, m_grid->cells())) {
+        qWarning() << "Simulation::updateRecording: cannot record to" << m_recordingFile
+                   << ":" << m_recorder->errorString();
+        delete m_recorder;
+        m_recorder = nullptr;
+    }
 }
 
-boost::optional<ChangeSet> Worker::pop(unsigned long waitTime)
+// Waits until everything is written.  Recording to the same file again
+// would truncate it, so unless another file was chosen, recording stops
+// until the user picks one.
+void Simulation::endRecording()
 {
-    QMutexLocker lock(&m_mutex);
+    if (m_recorder == nullptr)
+        return;
+
+    const QString fileName = m_recorder->fileName();
+    delete m_recorder;
+    m_recorder = nullptr;
 
-    if (m_queue.isEmpty()) {
-        if (!m_cond.wait(&m_mutex, waitTime) || m_queue.isEmpty())
-            return boost::none;
+    if (m_recordingFile == fileName) {
+        m_recordingFile.clear();
+        emit recordingEnded(fileName);
     }
+}
 
-    auto ret = m_queue.dequeue();
-    m_cond.wakeOne();
-    return ret;
+// A recording holds a single grid size, so a resize ends it; a run in
+// progress keeps recording until it stops.
+void Simulation::gridResized()
+{
+    discardOffGridCells();
+    if (!isRunning())
+        endRecording();
 }
 
-ChangeSet Worker::nextGeneration()
+void Simulation::setEngineType(Engine::Type type)
 {
-    namespace bimaps = boost::bimaps;
+    if (type != m_engineType)
+        discardOffGridCells();
+    m_engineType = type;
+}
 
-    ChangeSet ret;
-    boost::bimap<bimaps::unordered_set_of<QPoint, std::hash<QPoint>>,
-                 bimaps::multiset_of<int>> activeNeighbourCount;
+void Simulation::setThreadCount(int threadCount)
+{
+    Q_ASSERT(threadCount > 0);
 
-    for (auto&& cell : *m_grid) {
-        int count = 0;
-        for (auto neighbour = m_grid->neighbourIterator(cell);
-             neighbour != GridCellNeighbourIterator(); ++neighbour) {
-            if (m_grid->stateAt(*neighbour))
-                count++;
-            else {
-                auto it = activeNeighbourCount.left.find(*neighbour);
-                if (it != activeNeighbourCount.left.end())
-                    activeNeighbourCount.left.replace_data(it, it->second + 1);
-                else
-                    activeNeighbourCount.left.insert({*neighbour, 1});
-            }
-        }
+    m_engineOptions.threadCount = threadCount;
+}
 
-        if (count < 2 || count > 3)
-            ret.died += cell;
-    }
+void Simulation::setHashlifeMemoryLimit(int megabytes)
+{
+    Q_ASSERT(megabytes > 0);
 
-    auto spawnedCells = activeNeighbourCount.right.equal_range(3);
-    for (auto it = spawnedCells.first; it != spawnedCells.second; ++it)
-        ret.spawned += it->second;
+    m_engineOptions.hashlifeMemoryLimit = megabytes;
+}
+
+void Simulation::simulationStep()
+{
+    if (m_maxSpeed && !m_timer->isSingleShot()) {
+        applyPendingCoalesced();
+        m_timer->setInterval(FrameInterval);
+        return;
+    }
 
-    return ret;
+    ChangeSetQueue& queue = m_worker->queue();
+    if (ChangeSet *changeset = queue.front(100)) {
+        changeset->apply(m_grid);
+        queue.release();
+    }
+    m_timer->setInterval(m_delay);
 }
 
-bool Worker::push(const ChangeSet& elem)
+// Applies the net effect of the pending change sets at once.  Every change
+// toggles a cell, so a cell toggled an even number of times ends up where it
+// started and is left alone.  Only the change sets pending on entry are
+// taken, so that a producer refilling the queue cannot starve the GUI.
+void Simulation::applyPendingCoalesced()
 {
-    QMutexLocker lock(&m_mutex);
+    ChangeSetQueue& queue = m_worker->queue();
+    ChangeSet *changeset = queue.front(100);
+    if (changeset == nullptr)
+        return;
+    int pending = queue.depth();
+
+    if (m_toggled.size() != m_grid->cells().size())
+        m_toggled = CellBitSet(m_grid->cells().size());
+    m_touched.clear();
+
+    auto toggle = [this] (const QPoint& cell) {
+        bool toggled = !m_toggled.test(cell);
+        m_toggled.set(cell, toggled);
+        if (toggled)
+            m_touched += cell;
+    };
+
+    for (; changeset; changeset = --pending > 0 ? queue.front() : nullptr) {
+        for (const QPoint& cell : changeset->died)
+            toggle(cell);
+        for (const QPoint& cell : changeset->spawned)
+            toggle(cell);
+        queue.release();
+    }
 
-    if (m_queue.size() == MaxQueueSize) {
-        if (!m_cond.wait(&m_mutex) || m_queue.size() == MaxQueueSize)
-            return false;
+    m_coalesced.clear();
+    for (const QPoint& cell : m_touched) {
+        if (!m_toggled.test(cell))
+            continue;
+        m_toggled.set(cell, false);
+        if (m_grid->stateAt(cell))
+            m_coalesced.died += cell;
+        else
+            m_coalesced.spawned += cell;
     }
 
-    m_queue.enqueue(elem);
-    m_cond.wakeOne();
-    return true;
+    m_coalesced.apply(m_grid);
+}
+
+int Simulation::queueDepth() const
+{
+    return m_worker ? m_worker->queue().depth() : 0;
+}
+
+quint64 Simulation::producerStalls() const
+{
+    return m_worker ? m_worker->queue().producerStalls() : 0;
+}
+
+quint64 Simulation::consumerStalls() const
+{
+    return m_worker ? m_worker->queue().consumerStalls() : 0;
+}
+
+void Simulation::waitForAndDeleteFinishedWorker()
+{
+    Worker *worker = qobject_cast<Worker*>(sender());
+
+    worker->wait();
+    delete worker;
 }
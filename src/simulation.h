@@ -3,9 +3,14 @@
 
 #include <QObject>
 #include <QPointer>
+#include <QString>
+#include "cellbitset.h"
+#include "changeset.h"
 #include "grid.h"
+#include "engine.h"
 
 class QTimer;
+class Recorder;
 class Worker;
 
 class Simulation : public QObject
@@ -16,29 +21,71 @@ public:
 
     bool isRunning() const { return m_worker != nullptr; }
     const Grid *preSimulationGrid() const { return m_preSimulationGrid; }
+    Engine::Type engineType() const { return m_engineType; }
+    void setEngineType(Engine::Type type);
+    const EngineOptions& engineOptions() const { return m_engineOptions; }
+    int threadCount() const { return m_engineOptions.threadCount; }
+    void setThreadCount(int threadCount);
+    void setHashlifeMemoryLimit(int megabytes);
+    bool maxSpeed() const { return m_maxSpeed; }
+    // Runs are recorded to this file while set, see Recorder.  Restarting
+    // the simulation continues the recording.  Resetting it or resizing the
+    // grid ends the recording and clears the file name, see recordingEnded().
+    QString recordingFile() const { return m_recordingFile; }
+    void setRecordingFile(const QString& fileName);
+
+    // Monitoring of the worker's change set queue; zero while not running.
+    int queueDepth() const;
+    quint64 producerStalls() const;
+    quint64 consumerStalls() const;
+
 public slots:
     void startOrContinue();
     void startOrDoSingleStep();
+    void jump(quint64 generations);
     void stop();
     void reset();
+    // The unbounded engine keeps stepping the same plane across runs, so
+    // that cells which left the grid come back after a jump or a restart.
+    // Resetting, resizing the grid or switching engines forgets them, as
+    // does this.
+    void discardOffGridCells();
     void setDelay(int milis);
+    void setMaxSpeed(bool enabled);
 
 signals:
     void started();
     void ended();
+    // Recording to `fileName' stopped without another file being chosen.
+    void recordingEnded(const QString& fileName);
 
 private slots:
     void simulationStep();
+    void gridResized();
     void waitForAndDeleteFinishedWorker();
 
 private:
-    void startWorker();
+    void startWorker(quint64 jump = 0);
+    void applyPendingCoalesced();
+    void updateRecording();
+    void endRecording();
 
     QPointer<Grid> m_grid;
     QTimer *m_timer;
     Worker *m_worker = nullptr;
     int m_delay = 100;
+    bool m_maxSpeed = false;
+    // Scratch state for folding several change sets into one.
+    CellBitSet m_toggled;
+    QVector<QPoint> m_touched;
+    ChangeSet m_coalesced;
+    Engine::Type m_engineType = Engine::Type::Packed;
+    EngineOptions m_engineOptions;
     Grid *m_preSimulationGrid = nullptr;
+    QString m_recordingFile;
+    Recorder *m_recorder = nullptr;
+    // The grid as recorded at the end of the last run.
+    CellBitSet m_recordedCells;
 };
 
 #endif /* SIMULATION_H_INCLUDED */
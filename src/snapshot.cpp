@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <QFile>
+#include <QFileDevice>
+#include <QVector>
+#include <QtDebug>
+#include <QtEndian>
+#include "snapshot.h"
+
+const char Snapshot::Magic[8] = {'L', 'I', 'F', 'E', 'S', 'N', 'A', 'P'};
+
+namespace {
+    using Word = CellBitSet::Word;
+
+    const char Rule[] = "B3/S23";
+
+    // Keeps a file mapped for as long as a bit set uses its bands.
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const QString& fileName)
+            : m_file(fileName)
+        { }
+        ~MappedFile()
+        {
+            if (m_data)
+                m_file.unmap(m_data);
+        }
+
+        const uchar *map(qint64 offset, qint64 size)
+        {
+            if (m_file.open(QIODevice::ReadOnly))
+                m_data = m_file.map(offset, size);
+            return m_data;
+        }
+
+    private:
+        QFile m_file;
+        uchar *m_data = nullptr;
+    };
+
+    bool fail(QString *error, const QString& message)
+    {
+        if (error)
+            *error = message;
+        return false;
+    }
+
+    qint64 bandWords(int cols, int rows, int band)
+    {
+        return qint64(qMin(int(CellBitSet::BandRows), rows - band * CellBitSet::BandRows))
+            * CellBitSet::wordsForColumns(cols);
+    }
+
+    bool writeWords(QIODevice *device, const Word *words, qint64 count)
+    {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        qint64 bytes = count * qint64(sizeof(Word));
+        return device->write(reinterpret_cast<const char*>(words), bytes) == bytes;
+#else
+        Word swapped[512];
+        while (count > 0) {
+            int n = int(qMin<qint64>(count, 512));
+            for (int i = 0; i < n; ++i)
+                swapped[i] = qToLittleEndian(words[i]);
+            if (device->write(reinterpret_cast<const char*>(swapped), n * sizeof(Word))
+                != qint64(n * sizeof(Word)))
+                return false;
+            words += n;
+            count -= n;
+        }
+        return true;
+#endif
+    }
+
+    bool readWords(QIODevice *device, Word *words, qint64 count)
+    {
+        qint64 bytes = count * qint64(sizeof(Word));
+        if (device->read(reinterpret_cast<char*>(words), bytes) != bytes)
+            return false;
+        for (qint64 i = 0; i < count; ++i)
+            words[i] = qFromLittleEndian(words[i]);
+        return true;
+    }
+}
+
+bool Snapshot::isSnapshot(const QByteArray& head)
+{
+    return head.startsWith(QByteArray::fromRawData(Magic, sizeof Magic));
+}
+
+bool Snapshot::write(QIODevice *device, const CellBitSet& cells, quint64 generation)
+{
+    const int bands = cells.bands();
+    QVector<Word> stored((bands + CellBitSet::WordBits - 1) / CellBitSet::WordBits, 0);
+    bool sparse = false;
+
+    for (int band = 0; band < bands; ++band) {
+        const Word *words = cells.row(band * CellBitSet::BandRows);
+        if (std::all_of(words, words + cells.bandWords(band), [] (Word word) { return word == 0; }))
+            sparse = true;
+        else
+            stored[band / CellBitSet::WordBits] |= Word(1) << (band % CellBitSet::WordBits);
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof header);
+    std::memcpy(header.magic, Magic, sizeof Magic);
+    std::memcpy(header.rule, Rule, sizeof Rule);
+    header.version = qToLittleEndian(Version);
+    header.flags = qToLittleEndian(quint32(sparse ? SparseBands : 0));
+    header.cols = qToLittleEndian(qint32(cells.cols()));
+    header.rows = qToLittleEndian(qint32(cells.rows()));
+    header.generation = qToLittleEndian(generation);
+    header.bandRows = qToLittleEndian(quint32(CellBitSet::BandRows));
+    header.wordsPerRow = qToLittleEndian(quint32(cells.wordsPerRow()));
+
+    bool ok = device->write(reinterpret_cast<const char*>(&header), sizeof header) == sizeof header;
+    if (ok && sparse)
+        ok = writeWords(device, stored.constData(), stored.size());
+
+    for (int band = 0; ok && band < bands; ++band) {
+        if ((stored.at(band / CellBitSet::WordBits) >> (band % CellBitSet::WordBits) & 1) || !sparse)
+            ok = writeWords(device, cells.row(band * CellBitSet::BandRows), cells.bandWords(band));
+    }
+
+    return ok;
+}
+
+bool Snapshot::read(QIODevice *device, CellBitSet& cells, quint64 *generation, QString *error)
+{
+    Header header;
+    if (device->read(reinterpret_cast<char*>(&header), sizeof header) != sizeof header
+        || std::memcmp(header.magic, Magic, sizeof Magic) != 0)
+        return fail(error, "not a snapshot");
+    if (qFromLittleEndian(header.version) != Version)
+        return fail(error, QString("unsupported snapshot version %1")
+                    .arg(qFromLittleEndian(header.version)));
+
+    const int cols = qFromLittleEndian(header.cols);
+    const int rows = qFromLittleEndian(header.rows);
+    if (cols <= 0 || rows <= 0
+        || qFromLittleEndian(header.bandRows) != quint32(CellBitSet::BandRows)
+        || qFromLittleEndian(header.wordsPerRow) != quint32(CellBitSet::wordsForColumns(cols)))
+        return fail(error, "invalid snapshot layout");
+    if (qstrncmp(header.rule, Rule, sizeof header.rule) != 0)
+        qWarning() << "Snapshot::read: ignoring rule"
+                   << QByteArray(header.rule, int(qstrnlen(header.rule, sizeof header.rule)));
+
+    const int bands = (rows + CellBitSet::BandRows - 1) / CellBitSet::BandRows;
+    const bool sparse = qFromLittleEndian(header.flags) & SparseBands;
+    QVector<Word> stored((bands + CellBitSet::WordBits - 1) / CellBitSet::WordBits, ~Word(0));
+    if (sparse && !readWords(device, stored.data(), stored.size()))
+        return fail(error, "truncated snapshot");
+
+    auto isStored = [&stored] (int band) {
+        return stored.at(band / CellBitSet::WordBits) >> (band % CellBitSet::WordBits) & 1;
+    };
+
+    qint64 total = 0;
+    for (int band = 0; band < bands; ++band)
+        if (isStored(band))
+            total += bandWords(cols, rows, band);
+
+    const qint64 offset = device->pos();
+    if (!device->isSequential() && device->size() - offset < total * qint64(sizeof(Word)))
+        return fail(error, "truncated snapshot");
+
+    std::shared_ptr<MappedFile> mapped;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    auto *file = qobject_cast<QFileDevice*>(device);
+    if (file && !file->isSequential() && !file->fileName().isEmpty() && total > 0) {
+        mapped = std::make_shared<MappedFile>(file->fileName());
+        if (const uchar *data = mapped->map(offset, total * qint64(sizeof(Word)))) {
+            QVector<const Word*> pointers(bands, nullptr);
+            const Word *words = reinterpret_cast<const Word*>(data);
+            for (int band = 0; band < bands; ++band) {
+                if (isStored(band)) {
+                    pointers[band] = words;
+                    words += bandWords(cols, rows, band);
+                }
+            }
+            cells = CellBitSet::fromRawBands(QSize(cols, rows), pointers, mapped);
+            device->seek(offset + total * qint64(sizeof(Word)));
+        } else {
+            mapped.reset();
+        }
+    }
+#endif
+
+    // Stray bits past the last column are left in mapped bands, which the
+    // bit set ignores, rather than touching every row here.  Bands read into
+    // memory are cleaned while they are still in the cache.
+    if (!mapped) {
+        cells = CellBitSet(QSize(cols, rows));
+        const Word mask = cells.lastWordMask();
+        const int words = cells.wordsPerRow();
+        for (int band = 0; band < bands; ++band) {
+            if (!isStored(band))
+                continue;
+            Word *data = cells.row(band * CellBitSet::BandRows);
+            if (!readWords(device, data, bandWords(cols, rows, band))) {
+                cells = CellBitSet();
+                return fail(error, "truncated snapshot");
+            }
+            if (mask != ~Word(0))
+                for (qint64 i = words - 1; i < bandWords(cols, rows, band); i += words)
+                    data[i] &= mask;
+        }
+    }
+
+    if (generation)
+        *generation = qFromLittleEndian(header.generation);
+    return true;
+}
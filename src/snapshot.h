@@ -0,0 +1,54 @@
+#ifndef SNAPSHOT_H_INCLUDED
+#define SNAPSHOT_H_INCLUDED
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+#include "cellbitset.h"
+
+class QIODevice;
+
+// Binary checkpoint of a whole grid: a 64-byte header with the size, rule and
+// generation, then the bands of bit-packed rows exactly as CellBitSet stores
+// them, in little-endian words.  Reading a snapshot from a file maps it, and
+// the bit set uses the mapped bands in place until they are written to.
+//
+// When some bands are empty, only the others are stored, after a bitmap of
+// the stored bands.
+class Snapshot
+{
+public:
+    static const char Magic[8];
+    static constexpr quint32 Version = 1;
+
+    // The bit set written is the whole grid, not just its bounding box.
+    static bool write(QIODevice *device, const CellBitSet& cells, quint64 generation = 0);
+    // Leaves the device just past the snapshot.
+    static bool read(QIODevice *device, CellBitSet& cells, quint64 *generation = nullptr,
+                     QString *error = nullptr);
+
+    static bool isSnapshot(const QByteArray& head);
+
+private:
+    enum Flag
+    {
+        SparseBands = 1
+    };
+
+    struct Header
+    {
+        char magic[8];
+        quint32 version;
+        quint32 flags;
+        qint32 cols;
+        qint32 rows;
+        quint64 generation;
+        char rule[16];
+        quint32 bandRows;
+        quint32 wordsPerRow;
+        char reserved[8];
+    };
+    static_assert(sizeof(Header) == 64, "snapshot header must stay 64 bytes");
+};
+
+#endif /* SNAPSHOT_H_INCLUDED */
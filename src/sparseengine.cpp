@@ -0,0 +1,98 @@
+#include <algorithm>
+#include "sparseengine.h"
+
+namespace {
+    constexpr int MinSlotBits = 10;
+}
+
+void SparseEngine::nextGeneration(const Grid& grid, ChangeSet& changes)
+{
+    changes.clear();
+    reset();
+
+    for (auto&& cell : grid) {
+        int count = 0;
+        for (auto neighbour = grid.neighbourIterator(cell);
+             neighbour != GridCellNeighbourIterator(); ++neighbour) {
+            if (grid.stateAt(*neighbour))
+                count++;
+            else
+                increment(*neighbour);
+        }
+
+        if (count < 2 || count > 3)
+            changes.died += cell;
+    }
+
+    for (int i = 0; i < m_used; ++i) {
+        if (m_entries[i].count == 3)
+            changes.spawned += m_entries[i].cell;
+    }
+}
+
+// Empties the table without touching the slots; a slot is only occupied if
+// its epoch matches the current one.
+void SparseEngine::reset()
+{
+    m_used = 0;
+
+    if (m_slots.isEmpty()) {
+        m_slots.fill({0, 0}, 1 << MinSlotBits);
+        m_entries.resize(m_slots.size() / 2);
+        m_shift = 64 - MinSlotBits;
+    }
+
+    if (++m_epoch == 0) {
+        std::fill(m_slots.begin(), m_slots.end(), Slot{0, 0});
+        m_epoch = 1;
+    }
+}
+
+void SparseEngine::increment(const QPoint& cell)
+{
+    const int mask = m_slots.size() - 1;
+    Slot *slots = m_slots.data();
+
+    for (int i = slotFor(cell); ; i = (i + 1) & mask) {
+        Slot& slot = slots[i];
+        if (slot.epoch != m_epoch) {
+            if (m_used == m_entries.size()) {
+                grow();
+                increment(cell);
+                return;
+            }
+            slot = {m_epoch, m_used};
+            m_entries[m_used++] = {cell, 1};
+            return;
+        }
+        Entry& entry = m_entries[slot.entry];
+        if (entry.cell == cell) {
+            entry.count++;
+            return;
+        }
+    }
+}
+
+// Doubles the table and the entry arena, keeping the load factor at or below
+// one half.  Entries are reinserted under a fresh epoch.
+void SparseEngine::grow()
+{
+    m_slots.fill({0, 0}, m_slots.size() * 2);
+    m_entries.resize(m_slots.size() / 2);
+    m_shift--;
+    m_epoch = 1;
+
+    const int mask = m_slots.size() - 1;
+    for (int e = 0; e < m_used; ++e) {
+        int i = slotFor(m_entries[e].cell);
+        while (m_slots[i].epoch == m_epoch)
+            i = (i + 1) & mask;
+        m_slots[i] = {m_epoch, e};
+    }
+}
+
+int SparseEngine::slotFor(const QPoint& cell) const
+{
+    quint64 key = quint64(quint32(cell.x())) << 32 | quint32(cell.y());
+    return int((key * Q_UINT64_C(0x9E3779B97F4A7C15)) >> m_shift);
+}
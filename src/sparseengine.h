@@ -0,0 +1,42 @@
+#ifndef SPARSEENGINE_H_INCLUDED
+#define SPARSEENGINE_H_INCLUDED
+
+#include <QVector>
+#include "engine.h"
+
+// Visits every live cell and counts the neighbours of its dead neighbours.
+// The counts live in an open-addressing table whose slots are invalidated by
+// bumping an epoch, so that once the table has grown to fit the pattern a
+// generation performs no heap allocations.
+class SparseEngine : public Engine
+{
+public:
+    virtual QString name() const override { return describe(Type::Sparse); }
+    virtual void nextGeneration(const Grid& grid, ChangeSet& changes) override;
+
+private:
+    struct Slot
+    {
+        quint32 epoch;
+        int entry;
+    };
+
+    struct Entry
+    {
+        QPoint cell;
+        int count;
+    };
+
+    void reset();
+    void increment(const QPoint& cell);
+    void grow();
+    int slotFor(const QPoint& cell) const;
+
+    QVector<Slot> m_slots;
+    QVector<Entry> m_entries;
+    int m_used = 0;
+    int m_shift = 64;
+    quint32 m_epoch = 0;
+};
+
+#endif /* SPARSEENGINE_H_INCLUDED */
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <QtAlgorithms>
+#include "packedkernel.h"
+#include "sparseplane.h"
+
+SparsePlane::SparsePlane()
+    : m_kernel(PackedKernel::active())
+{ }
+
+bool SparsePlane::test(qint64 x, qint64 y) const
+{
+    auto it = m_tiles.constFind(tileOf(x, y));
+    return it != m_tiles.cend() && (it.value()[y & (TileSize - 1)] >> (x & (TileSize - 1))) & 1;
+}
+
+void SparsePlane::set(qint64 x, qint64 y, bool state)
+{
+    TileKey key = tileOf(x, y);
+    Word bit = Word(1) << (x & (TileSize - 1));
+    int row = y & (TileSize - 1);
+
+    if (state) {
+        auto it = m_tiles.find(key);
+        if (it == m_tiles.end())
+            it = m_tiles.insert(key, Tile{});
+        it.value()[row] |= bit;
+        return;
+    }
+
+    auto it = m_tiles.find(key);
+    if (it == m_tiles.end())
+        return;
+    it.value()[row] &= ~bit;
+    if (std::all_of(it.value().cbegin(), it.value().cend(), [] (Word word) { return word == 0; }))
+        m_tiles.erase(it);
+}
+
+void SparsePlane::clear()
+{
+    m_tiles.clear();
+    m_changedTiles.clear();
+}
+
+qint64 SparsePlane::population() const
+{
+    qint64 ret = 0;
+    for (const Tile& tile : m_tiles)
+        for (Word word : tile)
+            ret += qPopulationCount(word);
+    return ret;
+}
+
+SparsePlane::Bounds SparsePlane::boundingBox() const
+{
+    Bounds ret;
+    bool first = true;
+
+    for (auto it = m_tiles.cbegin(); it != m_tiles.cend(); ++it) {
+        const Tile& tile = it.value();
+        int top = 0, bottom = TileSize - 1;
+        while (tile[top] == 0)
+            ++top;
+        while (tile[bottom] == 0)
+            --bottom;
+        Word columns = 0;
+        for (Word word : tile)
+            columns |= word;
+
+        qint64 x = it.key().x * TileSize, y = it.key().y * TileSize;
+        Bounds bounds;
+        bounds.left = x + qCountTrailingZeroBits(columns);
+        bounds.right = x + TileSize - 1 - qCountLeadingZeroBits(columns);
+        bounds.top = y + top;
+        bounds.bottom = y + bottom;
+
+        if (first) {
+            ret = bounds;
+            first = false;
+        } else {
+            ret.left = std::min(ret.left, bounds.left);
+            ret.top = std::min(ret.top, bounds.top);
+            ret.right = std::max(ret.right, bounds.right);
+            ret.bottom = std::max(ret.bottom, bounds.bottom);
+        }
+    }
+
+    return ret;
+}
+
+SparsePlane::Word SparsePlane::tileRow(const TileKey& key, int row) const
+{
+    auto it = m_tiles.constFind(key);
+    return it == m_tiles.cend() ? 0 : it.value()[row];
+}
+
+// Only the allocated tiles and their neighbours can hold live cells in the
+// next generation.
+bool SparsePlane::step()
+{
+    QHash<TileKey, Tile> next;
+    next.reserve(m_tiles.size() * 2);
+    m_visited.clear();
+    m_changedTiles.clear();
+
+    for (auto it = m_tiles.cbegin(); it != m_tiles.cend(); ++it) {
+        for (qint64 dy = -1; dy <= 1; ++dy) {
+            for (qint64 dx = -1; dx <= 1; ++dx) {
+                TileKey key{it.key().x + dx, it.key().y + dy};
+                if (!m_visited.contains(key)) {
+                    m_visited.insert(key, true);
+                    stepTile(key, next);
+                }
+            }
+        }
+    }
+
+    m_tiles.swap(next);
+    return !m_changedTiles.isEmpty();
+}
+
+void SparsePlane::stepTile(const TileKey& key, QHash<TileKey, Tile>& next)
+{
+    // The tile and its neighbours, indexed by [dy + 1][dx + 1].
+    const Tile *tiles[3][3];
+    for (int dy = -1; dy <= 1; ++dy)
+        for (int dx = -1; dx <= 1; ++dx) {
+            auto it = m_tiles.constFind({key.x + dx, key.y + dy});
+            tiles[dy + 1][dx + 1] = it == m_tiles.cend() ? nullptr : &it.value();
+        }
+
+    // Fills a row padded with the last word of the west neighbour and the
+    // first word of the east one, as the kernel expects.
+    auto paddedRow = [&tiles] (int row, Word *out) {
+        int band = row < 0 ? 0 : row < TileSize ? 1 : 2;
+        row &= TileSize - 1;
+        for (int dx = 0; dx < 3; ++dx)
+            out[dx] = tiles[band][dx] ? (*tiles[band][dx])[row] : 0;
+    };
+
+    Word rows[3][3];
+    paddedRow(-1, rows[0]);
+    paddedRow(0, rows[1]);
+
+    Tile result;
+    Word any = 0;
+    for (int row = 0; row < TileSize; ++row) {
+        Word *up = rows[row % 3], *mid = rows[(row + 1) % 3], *down = rows[(row + 2) % 3];
+        paddedRow(row + 1, down);
+        m_kernel.stepRow(up + 1, mid + 1, down + 1, &result[row], 1);
+        any |= result[row];
+    }
+
+    const Tile *current = tiles[1][1];
+    if (any)
+        next.insert(key, result);
+    if (current ? *current != result : any != 0)
+        m_changedTiles += key;
+}
@@ -0,0 +1,104 @@
+#ifndef SPARSEPLANE_H_INCLUDED
+#define SPARSEPLANE_H_INCLUDED
+
+#include <array>
+#include <QHash>
+#include <QtAlgorithms>
+#include <QVector>
+#include <QtGlobal>
+#include "cellbitset.h"
+
+class PackedKernel;
+
+// An unbounded plane of cells with 64-bit coordinates.  The plane is split
+// into tiles of TileSize x TileSize cells, one word per tile row, which are
+// allocated when a cell in them comes alive and freed once they are empty.
+class SparsePlane
+{
+public:
+    using Word = CellBitSet::Word;
+    static constexpr int TileBits = 6;
+    static constexpr int TileSize = 1 << TileBits;
+    static_assert(TileSize == CellBitSet::WordBits, "a tile row must be one word");
+
+    struct TileKey
+    {
+        qint64 x;
+        qint64 y;
+
+        bool operator==(const TileKey& rhs) const { return x == rhs.x && y == rhs.y; }
+    };
+
+    // Inclusive bounds of the live cells.
+    struct Bounds
+    {
+        qint64 left = 0;
+        qint64 top = 0;
+        qint64 right = -1;
+        qint64 bottom = -1;
+
+        bool isEmpty() const { return right < left || bottom < top; }
+        qint64 width() const { return right - left + 1; }
+        qint64 height() const { return bottom - top + 1; }
+    };
+
+    SparsePlane();
+
+    static TileKey tileOf(qint64 x, qint64 y) { return { x >> TileBits, y >> TileBits }; }
+
+    // Exchanges the cells of two planes.  Copying a plane is cheap until
+    // either of them changes, so a copy can serve to undo steps.
+    void swap(SparsePlane& other)
+    {
+        m_tiles.swap(other.m_tiles);
+        m_changedTiles.swap(other.m_changedTiles);
+    }
+
+    bool test(qint64 x, qint64 y) const;
+    void set(qint64 x, qint64 y, bool state);
+    void clear();
+
+    qint64 population() const;
+    int tileCount() const { return m_tiles.size(); }
+    Bounds boundingBox() const;
+
+    // Row `row' of a tile; zero for tiles that are not allocated.
+    Word tileRow(const TileKey& key, int row) const;
+
+    // Advances the plane by one generation and returns whether any cell
+    // changed.  Afterwards changedTiles() lists the tiles whose contents
+    // changed, including the ones freed.
+    bool step();
+    const QVector<TileKey>& changedTiles() const { return m_changedTiles; }
+
+    // Calls f(x, y) for every live cell, tile by tile.
+    template <typename Function>
+    void forEachCell(Function f) const
+    {
+        for (auto it = m_tiles.cbegin(); it != m_tiles.cend(); ++it) {
+            for (int row = 0; row < TileSize; ++row) {
+                for (Word bits = it.value()[row]; bits; bits &= bits - 1) {
+                    f(it.key().x * TileSize + qCountTrailingZeroBits(bits),
+                      it.key().y * TileSize + row);
+                }
+            }
+        }
+    }
+
+private:
+    using Tile = std::array<Word, TileSize>;
+
+    void stepTile(const TileKey& key, QHash<TileKey, Tile>& next);
+
+    const PackedKernel& m_kernel;
+    QHash<TileKey, Tile> m_tiles;
+    QHash<TileKey, bool> m_visited;
+    QVector<TileKey> m_changedTiles;
+};
+
+inline uint qHash(const SparsePlane::TileKey& key, uint seed = 0)
+{
+    return qHash(quint64(key.x) * 0x9E3779B97F4A7C15ull ^ quint64(key.y), seed);
+}
+
+#endif /* SPARSEPLANE_H_INCLUDED */
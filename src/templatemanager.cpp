@@ -1,9 +1,9 @@
 #include <QDirIterator>
 #include <QBuffer>
 #include <QPainter>
-#include <QTextStream>
 #include <QPixmap>
 #include <QFileSystemWatcher>
+#include <QSaveFile>
 #include <QDebug>
 #include "templatemanager.h"
 #include "grid.h"
@@ -52,11 +52,8 @@ Grid *SavedTemplateItem::grid()
     qDebug() << "SavedTemplateItem::grid: open" << m_path;
 
     if (file.open(QIODevice::ReadOnly)) {
-        QTextStream in{&file};
         ret = new Grid({1, 1});
-        in >> *ret;
-
-        if (!ret->isValid()) {
+        if (!ret->load(&file)) {
             delete ret;
             ret = nullptr;
         }
@@ -191,18 +188,15 @@ bool TemplateManager::addTemplate(const QString& name, Grid *grid)
             return false;
         }
 
-    QFile f{templatesDirectory().absoluteFilePath(name)};
+    // Written aside and renamed over the old file, so that a template still
+    // mapped from the old snapshot keeps reading the old contents.
+    QSaveFile f{templatesDirectory().absoluteFilePath(name)};
     if (!f.open(QIODevice::WriteOnly))
         return false;
 
-    QTextStream out{&f};
-    out << *grid;
-    f.close();
-
-    if (out.status() == QTextStream::Ok)
-        return true;
-
-    return false;
+    // The format follows the name, e.g. "gun.rle"; other names get the
+    // native format.
+    return grid->save(&f, patternFormatForFileName(name)) && f.commit();
 }
 
 QDir TemplateManager::templatesDirectory()
@@ -1,27 +1,59 @@
+#include <QGraphicsPixmapItem>
 #include <QKeyEvent>
+#include <QMouseEvent>
 #include "templatepainter.h"
 #include "gridview.h"
+#include "griditem.h"
+
+namespace {
+    // Live template cells are drawn solid, dead ones as a faint tint that
+    // shows the area insertion overwrites.
+    QPixmap previewPixmap(const Grid& template_)
+    {
+        QImage image(template_.cols(), template_.rows(), QImage::Format_ARGB32_Premultiplied);
+
+        image.fill(qRgba(0, 0, 96, 96));
+        for (const QPoint& cell : template_)
+            image.setPixel(cell, qRgba(0, 0, 128, 255));
+
+        return QPixmap::fromImage(image);
+    }
+}
 
 GridTemplatePainter::GridTemplatePainter(GridView *view, Grid *template_, QObject *parent)
     : GridMouseTool(view, parent),
-      m_template(template_)
-{ }
+      m_template(template_),
+      m_gridItem(view->item()),
+      m_preview(new QGraphicsPixmapItem(previewPixmap(*template_), view->item()))
+{
+    m_preview->setScale(GridItem::CellSize);
+    m_preview->setOpacity(PreviewOpacity);
+    m_preview->setTransformationMode(Qt::FastTransformation);
+    m_preview->hide();
+}
 
 GridTemplatePainter::~GridTemplatePainter()
 {
-    if (view() && view()->grid() && !isDone()) {
-        maybeHidePreview(m_insertionPoint, true);
+    if (view() && view()->grid() && !isDone())
         finish();
-    }
+
+    // The grid item deletes its children when it goes first.
+    if (m_gridItem)
+        delete m_preview;
 }
 
 void GridTemplatePainter::mouseMoveEvent(QEvent *event, boost::optional<QPoint> item)
 {
-    if (isDone() || !item)
+    if (isDone())
         return;
 
-    maybeHidePreview(*item);
-    drawTemplate(*item, TemplateInsertMode::ShowPreview);
+    if (!item) {
+        m_preview->hide();
+        return;
+    }
+
+    m_preview->setPos(m_gridItem->cellRect(*item).topLeft());
+    m_preview->show();
 }
 
 void GridTemplatePainter::mousePressEvent(QEvent *event, boost::optional<QPoint> item)
@@ -30,61 +62,43 @@ void GridTemplatePainter::mousePressEvent(QEvent *event, boost::optional<QPoint>
     if (isDone() || !item || mevent->buttons() != Qt::LeftButton)
         return;
 
-    maybeHidePreview(*item);
-    drawTemplate(*item, TemplateInsertMode::Insert);
+    insertTemplate(*item);
     finish();
 }
 
 void GridTemplatePainter::keyPressEvent(QKeyEvent *event)
 {
     if (event->key() == Qt::Key_Escape)
-        if (!isDone()) {
-            maybeHidePreview(m_insertionPoint, true);
+        if (!isDone())
             finish();
-        }
 }
 
 void GridTemplatePainter::mouseReleaseEvent(QEvent *event, boost::optional<QPoint> item)
 {
-    if (m_lastInsertMode && *m_lastInsertMode == TemplateInsertMode::Insert)
+    if (m_inserted)
         emit done();
 }
 
-void GridTemplatePainter::maybeHidePreview(const QPoint& cell, bool force)
+void GridTemplatePainter::finish()
 {
-    if (m_lastInsertMode && *m_lastInsertMode == TemplateInsertMode::ShowPreview) {
-        if (m_insertionPoint == cell && !force)
-            return;
-        drawTemplate(m_insertionPoint, TemplateInsertMode::HidePreview);
-    }
+    m_done = true;
+    if (m_gridItem)
+        m_preview->hide();
+    emit done();
 }
 
-void GridTemplatePainter::drawTemplate(const QPoint& insertionPoint, TemplateInsertMode mode)
+void GridTemplatePainter::insertTemplate(const QPoint& insertionPoint)
 {
-    auto cellIsValid = [this] (const QPoint& cell) {
-        return cell.x() >= 0 && cell.y() >= 0
-        && cell.x() < view()->grid()->cols()
-        && cell.y() < view()->grid()->rows();
-    };
+    Grid *grid = view()->grid();
 
+    grid->beginUpdate();
     for (int i = 0; i < m_template->cols(); ++i) {
         for (int j = 0; j < m_template->rows(); ++j) {
             QPoint cell{i, j};
-            bool templateState = m_template->stateAt(cell);
-
-            cell += insertionPoint;
-            if (!cellIsValid(cell))
-                continue;
-
-            if (mode == TemplateInsertMode::ShowPreview)
-                view()->setVisibleCellState(cell, templateState);
-            if (mode == TemplateInsertMode::HidePreview)
-                view()->setVisibleCellState(cell, view()->grid()->stateAt(cell));
-            if (mode == TemplateInsertMode::Insert)
-                view()->grid()->setCellStateAt(cell, templateState);
+            grid->setCellStateAt(cell + insertionPoint, m_template->stateAt(cell));
         }
     }
+    grid->endUpdate();
 
-    m_insertionPoint = insertionPoint;
-    m_lastInsertMode = mode;
+    m_inserted = true;
 }
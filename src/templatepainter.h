@@ -5,10 +5,16 @@
 #include "grid.h"
 #include "cellpainter.h"
 
+class GridItem;
+class QGraphicsPixmapItem;
+
 class GridTemplatePainter : public GridMouseTool
 {
     Q_OBJECT
 public:
+    // Opacity of the preview drawn over the grid.
+    static constexpr qreal PreviewOpacity = 0.6;
+
     GridTemplatePainter(GridView *view, Grid *template_, QObject *parent = nullptr);
     virtual ~GridTemplatePainter();
 
@@ -24,16 +30,15 @@ protected:
     virtual void keyPressEvent(QKeyEvent *event) override;
 
 private:
-    enum class TemplateInsertMode { ShowPreview, HidePreview, Insert };
-
-    void maybeHidePreview(const QPoint& cell, bool force = false);
-    void drawTemplate(const QPoint& insertionPoint, TemplateInsertMode mode);
-
-    void finish() { m_done = true; emit done(); }
+    void insertTemplate(const QPoint& insertionPoint);
+    void finish();
 
     QPointer<Grid> m_template;
-    QPoint m_insertionPoint;
-    boost::optional<TemplateInsertMode> m_lastInsertMode;
+    // The preview is a child of the grid item and is rendered once, so
+    // following the mouse only moves it.
+    QPointer<GridItem> m_gridItem;
+    QGraphicsPixmapItem *m_preview;
+    bool m_inserted = false;
     bool m_done = false;
 };
 